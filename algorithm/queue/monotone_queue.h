@@ -0,0 +1,102 @@
+#ifndef ALGORITHM_MONOTONE_QUEUE_H_
+#define ALGORITHM_MONOTONE_QUEUE_H_
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace algorithm {
+namespace queue {
+
+// min priority queue of the double key for monotone workload, the key of a
+// push is never less than the last popped key. Items are kept in buckets of
+// the width, a bucket is sorted once when the queue reaches it.
+template <class T, class Key>
+class MonotoneQueue
+{
+public:
+    explicit MonotoneQueue(double width=1.0): width_(width){}
+
+    bool empty() const { return size_ == 0; }
+    int size() const { return size_; }
+
+    void push(const T& item)
+    {
+        long bucket = Bucket(item);
+        if (buckets_.empty())
+            base_ = bucket;
+        // before any pop, the lightest bucket may still move down
+        if (bucket < base_)
+        {
+            buckets_.insert(buckets_.begin(), base_ - bucket, std::vector<T>());
+            base_ = bucket;
+        }
+
+        int index = (int) (bucket - base_);
+        if (index >= (int) buckets_.size())
+            buckets_.resize(index + 1);
+
+        std::vector<T>& items = buckets_[index];
+        if (index == cursor_ && sorted_)
+        {
+            auto it = std::upper_bound(items.begin() + head_, items.end(), item,
+                [this](const T& a, const T& b) { return key_(a) < key_(b); });
+            items.insert(it, item);
+        }
+        else
+        {
+            items.push_back(item);
+        }
+        size_++;
+    }
+
+    const T& top()
+    {
+        Advance();
+        return buckets_[cursor_][head_];
+    }
+
+    void pop()
+    {
+        Advance();
+        head_++;
+        size_--;
+    }
+
+protected:
+    long Bucket(const T& item) const
+    {
+        return (long) std::floor(key_(item) / width_);
+    }
+
+    void Advance()
+    {
+        while (head_ >= (int) buckets_[cursor_].size())
+        {
+            buckets_[cursor_].clear();
+            cursor_++;
+            head_ = 0;
+            sorted_ = false;
+        }
+        if (!sorted_)
+        {
+            std::sort(buckets_[cursor_].begin(), buckets_[cursor_].end(),
+                [this](const T& a, const T& b) { return key_(a) < key_(b); });
+            sorted_ = true;
+        }
+    }
+
+    double width_;
+    Key key_;
+    long base_ = 0;
+    int cursor_ = 0;
+    int head_ = 0;
+    bool sorted_ = false;
+    int size_ = 0;
+    std::vector<std::vector<T>> buckets_;
+};
+
+} // namespace queue
+} // namespace algorithm
+
+#endif
@@ -0,0 +1,93 @@
+#define BOOST_TEST_MODULE QueueTest
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <queue>
+#include <random>
+#include "monotone_queue.h"
+#include "queue_trace.h"
+
+
+namespace algorithm {
+namespace queue {
+
+struct Identity
+{
+    double operator()(double value) const { return value; }
+};
+
+// trace of the glycan dp, peptide Y1 roots, then each pop pushes
+// children heavier by a monosaccharide
+template <class Queue>
+std::vector<double> Trace(Queue& queue, int roots, int limit, unsigned seed)
+{
+    const std::vector<double> sugars {203.0794, 162.0528, 146.0579, 291.0954};
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> peptide(800.0, 3000.0);
+    std::uniform_int_distribution<int> branch(0, 3);
+
+    for(int i = 0; i < roots; i++)
+    {
+        queue.push(peptide(gen));
+    }
+
+    std::vector<double> popped;
+    while (!queue.empty())
+    {
+        double mass = queue.top();
+        queue.pop();
+        popped.push_back(mass);
+        if ((int) (popped.size() + queue.size()) >= limit)
+            continue;
+        int children = branch(gen);
+        for(int i = 0; i < children; i++)
+        {
+            queue.push(mass + sugars[i]);
+        }
+    }
+    return popped;
+}
+
+BOOST_AUTO_TEST_CASE( monotone_queue_test )
+{
+    MonotoneQueue<double, Identity> queue;
+    BOOST_CHECK(queue.empty());
+    queue.push(1000.5);
+    queue.push(1000.2);
+    queue.push(998.7);
+    BOOST_CHECK(queue.size() == 3);
+    BOOST_CHECK(queue.top() == 998.7);
+    queue.pop();
+    queue.push(1000.3); // same bucket after it is sorted
+    queue.push(1146.1);
+    std::vector<double> expect {1000.2, 1000.3, 1000.5, 1146.1};
+    for(const auto& mass : expect)
+    {
+        BOOST_CHECK(queue.top() == mass);
+        queue.pop();
+    }
+    BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE( monotone_queue_trace_test )
+{
+    // the pops of the bucket queue as of the heap, on a dp like workload
+    int roots = 200, limit = 20000;
+    std::priority_queue<double, std::vector<double>, std::greater<double>> heap;
+    MonotoneQueue<double, Identity> bucket;
+    std::vector<double> expect = Trace(heap, roots, limit, 7);
+    std::vector<double> popped = Trace(bucket, roots, limit, 7);
+    BOOST_CHECK(popped == expect);
+    BOOST_CHECK(std::is_sorted(popped.begin(), popped.end()));
+
+    // a recorded run replayed on another queue
+    std::vector<double> trace;
+    TracedQueue<decltype(heap), Identity> traced(heap, trace);
+    expect = Trace(traced, roots, limit, 11);
+    popped.clear();
+    MonotoneQueue<double, Identity> replayed;
+    ReplayTrace(replayed, trace, popped);
+    BOOST_CHECK(popped == expect);
+}
+
+} // namespace queue
+} // namespace algorithm
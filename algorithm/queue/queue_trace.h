@@ -0,0 +1,68 @@
+#ifndef ALGORITHM_QUEUE_TRACE_H_
+#define ALGORITHM_QUEUE_TRACE_H_
+
+#include <vector>
+
+namespace algorithm {
+namespace queue {
+
+// the operations on a priority queue of a run, the key of each push and kPop
+// for each pop, to be replayed on another queue with the same keys
+static const double kPop = -1.0;
+
+// forwards to the queue while recording its operations into the trace
+template <class Queue, class Key>
+class TracedQueue
+{
+public:
+    TracedQueue(Queue& queue, std::vector<double>& trace): 
+        queue_(queue), trace_(trace){}
+
+    bool empty() const { return queue_.empty(); }
+    int size() const { return (int) queue_.size(); }
+    decltype(auto) top() const { return queue_.top(); }
+
+    template <class T>
+    void push(const T& item)
+    {
+        trace_.push_back(Key()(item));
+        queue_.push(item);
+    }
+
+    void pop()
+    {
+        trace_.push_back(kPop);
+        queue_.pop();
+    }
+
+protected:
+    Queue& queue_;
+    std::vector<double>& trace_;
+};
+
+// replay the trace on a queue of the keys, the popped keys in order
+template <class Queue>
+void ReplayTrace(Queue& queue, const std::vector<double>& trace, std::vector<double>& popped)
+{
+    for(double key : trace)
+    {
+        if (key == kPop)
+        {
+            popped.push_back(queue.top());
+            queue.pop();
+        }
+        else
+        {
+            queue.push(key);
+        }
+    }
+    while (!queue.empty())
+    {
+        queue.pop();
+    }
+}
+
+} // namespace queue
+} // namespace algorithm
+
+#endif
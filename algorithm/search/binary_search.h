@@ -24,7 +24,7 @@ public:
 
     double Tolerance() const { return tolerance_; }
     model::spectrum::ToleranceBy ToleranceType() const { return type_; }
-    void set_tolerance(double tol) { tolerance_ = tol; }
+    void set_tolerance(double tol) override { tolerance_ = tol; }
     void set_tolerance_by(model::spectrum::ToleranceBy type) { type_ = type; }
 
     void Init(Points inputs, bool sorted=false) override
@@ -24,6 +24,9 @@ public:
     BucketSearch(model::spectrum::ToleranceBy type, double tol):
         type_(type), tolerance_(tol){}
     ~BucketSearch(){}
+
+    // the buckets are cut by the tolerance, so it takes effect at the next Init
+    void set_tolerance(double tol) override { tolerance_ = tol; }
     
     void Init(Points inputs, bool sorted=false) override
     {
@@ -21,6 +21,8 @@ public:
     virtual std::vector<T> Search(double expect) {return std::vector<T>();}
     virtual bool Match(double expect, double base) {return false;}
     virtual bool Match(double expect) {return false;}
+    // tolerance of the next Init and searches
+    virtual void set_tolerance(double tol) {}
 
 };
 
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <chrono>
+#include <queue>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "search_parameter.h"
+#include "search_dispatcher.h"
+#include "search_helper.h"
+#include "../util/io/mgf_parser.h"
+#include "../algorithm/queue/monotone_queue.h"
+#include "../algorithm/queue/queue_trace.h"
+
+// the binary heap against the monotone bucket queue, on the queue operations
+// of the glycan dp recorded from searching the spectra
+//   queue_benchmark <spectrum.mgf> <protein.fasta> [repeat]
+
+struct Identity
+{
+    double operator()(double value) const { return value; }
+};
+
+template <class Queue>
+double Replay(const std::vector<std::vector<double>>& traces, int repeat,
+    std::vector<double>& popped)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < repeat; r++)
+    {
+        popped.clear();
+        for(const auto& trace : traces)
+        {
+            Queue queue;
+            algorithm::queue::ReplayTrace(queue, trace, popped);
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "usage: queue_benchmark <spectrum.mgf> <protein.fasta> [repeat]" << std::endl;
+        return 1;
+    }
+    int repeat = argc > 3 ? std::max(1, atoi(argv[3])) : 10;
+
+    SearchParameter parameter;
+    parameter.n_thread = 1;
+    std::vector<model::protein::Protein> proteins = ReadProteins(argv[2]);
+    engine::protein::PeptideStore peptides = PeptidesDigestion(proteins, parameter);
+    engine::glycan::GlycanBuilder builder(parameter.hexNAc_upper_bound, 
+        parameter.hex_upper_bound, parameter.fuc_upper_bound, 
+        parameter.neuAc_upper_bound, parameter.neuGc_upper_bound,
+        parameter.complex, parameter.hybrid, parameter.highmannose);
+    builder.Build();
+
+    std::unique_ptr<util::io::SpectrumParser> parser = std::make_unique<util::io::MGFParser>();
+    util::io::SpectrumReader spectrum_reader(argv[1], std::move(parser));
+    std::vector<model::spectrum::Spectrum> spectra = spectrum_reader.ReleaseSpectrum();
+
+    // record
+    std::vector<std::vector<double>> traces;
+    SearchDispatcher searcher(&builder, peptides.Views(), parameter);
+    searcher.set_queue_trace(&traces);
+    searcher.Dispatch(spectra);
+    long pushes = 0, pops = 0;
+    for(const auto& trace : traces)
+    {
+        for(double key : trace)
+        {
+            if (key == algorithm::queue::kPop)
+                pops++;
+            else
+                pushes++;
+        }
+    }
+
+    // replay
+    std::vector<double> heap_popped, bucket_popped;
+    double heap_seconds = Replay<std::priority_queue<double, std::vector<double>, 
+        std::greater<double>>>(traces, repeat, heap_popped);
+    double bucket_seconds = Replay<algorithm::queue::MonotoneQueue<double, Identity>>(
+        traces, repeat, bucket_popped);
+
+    std::cout << "traces: " << traces.size() << " pushes: " << pushes << " pops: " << pops << std::endl;
+    std::cout << "heap: " << heap_seconds / repeat << " s" << std::endl;
+    std::cout << "bucket: " << bucket_seconds / repeat << " s" << std::endl;
+    if (heap_popped != bucket_popped)
+    {
+        std::cout << "pop orders differ" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef APP_SEARCH_CLIENT_H_
+#define APP_SEARCH_CLIENT_H_
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../util/io/local_socket.h"
+#include "../util/io/mgf_parser.h"
+
+// client of searching --serve, the command line of searching_client
+//   searching_client <socket> file <spectrum.mgf> [key=value...]
+//   searching_client <socket> scan <spectrum.mgf> <scan> [key=value...]
+//   searching_client <socket> shutdown
+class SearchClient
+{
+public:
+    // prints the reply to out, returns the exit code of the tool
+    static int Run(int argc, char *argv[], std::ostream& out)
+    {
+        if (argc < 3)
+        {
+            out << "usage: searching_client <socket> file <mgf> [key=value...]\n"
+                << "       searching_client <socket> scan <mgf> <scan> [key=value...]\n"
+                << "       searching_client <socket> shutdown" << std::endl;
+            return 1;
+        }
+        std::string command = argv[2];
+        std::ostringstream request;
+        int first_option = 0;
+        if (command == "file" && argc >= 4)
+        {
+            request << "FILE " << argv[3];
+            first_option = 4;
+        }
+        else if (command == "scan" && argc >= 5)
+        {
+            std::unique_ptr<util::io::SpectrumParser> parser = std::make_unique<util::io::MGFParser>();
+            util::io::SpectrumReader spectrum_reader(argv[3], std::move(parser));
+            int scan = atoi(argv[4]);
+            model::spectrum::Spectrum spectrum = spectrum_reader.GetSpectrum(scan);
+            if (spectrum.Peaks().empty())
+            {
+                out << "scan " << scan << " not found" << std::endl;
+                return 1;
+            }
+            // the masses as parsed, not rounded to the 6 digits of the stream
+            request.precision(10);
+            request << "SPECTRUM " << scan << " " << spectrum.PrecursorMZ() << " " 
+                << spectrum.PrecursorCharge() << " " << spectrum.Peaks().size();
+            first_option = 5;
+            for(int i = first_option; i < argc; i++)
+            {
+                request << " " << argv[i];
+            }
+            request << "\n";
+            for(const auto& pk : spectrum.Peaks())
+            {
+                request << pk.MZ() << " " << pk.Intensity() << "\n";
+            }
+            first_option = argc;
+        }
+        else if (command == "shutdown")
+        {
+            request << "SHUTDOWN";
+            first_option = argc;
+        }
+        else
+        {
+            out << "unknown command " << command << std::endl;
+            return 1;
+        }
+        for(int i = first_option; i < argc; i++)
+        {
+            request << " " << argv[i];
+        }
+        std::string text = request.str();
+        if (text.back() != '\n')
+            text += "\n";
+
+        util::io::LocalSocket client;
+        if (!client.Connect(argv[1]))
+        {
+            out << "cannot connect to " << argv[1] << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (!client.Write(text))
+            return 1;
+
+        // the status line, then the matches of a spectrum
+        std::string status, line;
+        if (!client.ReadLine(status))
+            return 1;
+        out << status << std::endl;
+        if (command == "scan" && status.compare(0, 3, "OK ") == 0)
+        {
+            int size = atoi(status.substr(3).c_str());
+            for(int i = 0; i < size && client.ReadLine(line); i++)
+            {
+                out << line << std::endl;
+            }
+        }
+        auto stop = std::chrono::steady_clock::now();
+        out << "time(ms): " << std::chrono::duration<double, std::milli>(stop - start).count() << std::endl;
+        return status.compare(0, 2, "OK") == 0 ? 0 : 1;
+    }
+};
+
+#endif
@@ -0,0 +1,424 @@
+#ifndef APP_SEARCH_DATABASE_H_
+#define APP_SEARCH_DATABASE_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+#include "search_parameter.h"
+#include "../util/io/mapped_file.h"
+#include "../util/mass/peptide.h"
+#include "../engine/protein/peptide_store.h"
+#include "../engine/glycan/glycan_builder.h"
+#include "../engine/search/fragment_index.h"
+
+// compiled search database, the digested target and decoy peptides with the
+// precursor masses and fragment index, and the glycan library with its lattice.
+// The file is memory mapped, the peptides and the large arrays of fragment index
+// are used in place.
+class SearchDatabase
+{
+public:
+    static const uint32_t kVersion = 2;
+
+    // peptides of target or decoy, views into the file in order of residues
+    struct PeptideSet
+    {
+        engine::protein::PeptideViews peptides;
+        const double* masses = nullptr;
+        engine::search::FragmentIndex index;
+    };
+
+    // kind of a glycan of the library, stored with its table
+    enum GlycanType { kComplex, kHybrid, kHighMannose, kGlycanTypes };
+
+    // FNV-1a over the sequence files and the parameters that shape the database
+    static uint64_t Key(const std::string& fasta_path, const std::string& decoy_path,
+        const SearchParameter& parameter)
+    {
+        uint64_t hash = kOffset;
+        hash = HashFile(hash, fasta_path);
+        hash = HashFile(hash, decoy_path);
+        std::stringstream ss;
+        ss << kVersion << " " << parameter.miss_cleavage << " " << parameter.oxidation << " "
+            << parameter.deamidation << " " << parameter.max_modifications << " "
+            << parameter.hexNAc_upper_bound << " "
+            << parameter.hex_upper_bound << " " << parameter.fuc_upper_bound << " "
+            << parameter.neuAc_upper_bound << " " << parameter.neuGc_upper_bound << " "
+            << parameter.complex << parameter.hybrid << parameter.highmannose;
+        for(const auto& p : parameter.proteases)
+        {
+            ss << " " << (int) p;
+        }
+        return Hash(hash, ss.str().data(), ss.str().size());
+    }
+
+    static bool Write(const std::string& path, uint64_t key,
+        const engine::protein::PeptideViews& peptides, const engine::protein::PeptideViews& decoy_peptides,
+        engine::glycan::GlycanBuilder& builder, int n_thread)
+    {
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open())
+            return false;
+
+        out.write(Magic(), kMagicSize);
+        uint32_t version[2] = {kVersion, 0};
+        out.write(reinterpret_cast<const char*>(version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+
+        WritePeptideSet(out, peptides, n_thread);
+        WritePeptideSet(out, decoy_peptides, n_thread);
+
+        // glycan library in order of index
+        const std::vector<model::glycan::Glycan*>& glycans = builder.GlycanListRef();
+        std::vector<int> types, table_offsets {0}, tables, compositions, child_offsets {0}, children;
+        std::vector<double> masses;
+        for(const auto& glycan : glycans)
+        {
+            types.push_back(TypeOf(glycan));
+            const std::vector<int>& table = glycan->TableConst();
+            tables.insert(tables.end(), table.begin(), table.end());
+            table_offsets.push_back((int) tables.size());
+            for(int m = 0; m < kMonosaccharides; m++)
+            {
+                auto it = glycan->CompositionConst().find(static_cast<model::glycan::Monosaccharide>(m));
+                compositions.push_back(it == glycan->CompositionConst().end() ? -1 : it->second);
+            }
+            masses.push_back(glycan->Mass());
+            for(const auto& g : glycan->Children())
+            {
+                children.push_back(g->Index());
+            }
+            child_offsets.push_back((int) children.size());
+        }
+        WriteArray(out, types);
+        WriteArray(out, table_offsets);
+        WriteArray(out, tables);
+        WriteArray(out, compositions);
+        WriteArray(out, masses);
+        WriteArray(out, child_offsets);
+        WriteArray(out, children);
+        return out.good();
+    }
+
+    // false if missing, built from other sequences or parameters, or corrupt,
+    // then the search space is built again
+    bool Load(const std::string& path, uint64_t key)
+    {
+        if (LoadFile(path, key))
+            return true;
+        // nothing of the file is kept
+        Clear(target_);
+        Clear(decoy_);
+        glycan_size_ = 0;
+        types_ = table_offsets_ = tables_ = compositions_ = child_offsets_ = children_ = nullptr;
+        glycan_masses_ = nullptr;
+        file_.Close();
+        return false;
+    }
+
+    const PeptideSet& Target() const { return target_; }
+    const PeptideSet& Decoy() const { return decoy_; }
+
+    // glycan library restored from the database
+    std::unique_ptr<engine::glycan::GlycanBuilder> Builder(const SearchParameter& parameter) const
+    {
+        std::unique_ptr<engine::glycan::GlycanBuilder> builder =
+            std::make_unique<engine::glycan::GlycanBuilder>(parameter.hexNAc_upper_bound,
+                parameter.hex_upper_bound, parameter.fuc_upper_bound,
+                    parameter.neuAc_upper_bound, parameter.neuGc_upper_bound,
+                        parameter.complex, parameter.hybrid, parameter.highmannose);
+        std::vector<std::unique_ptr<model::glycan::Glycan>> glycans;
+        for(int i = 0; i < glycan_size_; i++)
+        {
+            std::vector<int> table(tables_ + table_offsets_[i], tables_ + table_offsets_[i + 1]);
+            std::unique_ptr<model::glycan::Glycan> glycan = NewGlycan(types_[i]);
+            glycan->set_table(table);
+            std::map<model::glycan::Monosaccharide, int> composition;
+            for(int m = 0; m < kMonosaccharides; m++)
+            {
+                int count = compositions_[i * kMonosaccharides + m];
+                if (count >= 0)
+                    composition[static_cast<model::glycan::Monosaccharide>(m)] = count;
+            }
+            glycan->set_composition(composition);
+            glycan->set_mass(glycan_masses_[i]);
+            glycans.push_back(std::move(glycan));
+        }
+        std::vector<int> child_offsets(child_offsets_, child_offsets_ + glycan_size_ + 1);
+        std::vector<int> children(children_, children_ + child_offsets[glycan_size_]);
+        builder->Restore(glycans, child_offsets, children);
+        return builder;
+    }
+
+protected:
+    static int TypeOf(const model::glycan::Glycan* glycan)
+    {
+        if (dynamic_cast<const model::glycan::NGlycanHybrid*>(glycan) != nullptr)
+            return kHybrid;
+        if (dynamic_cast<const model::glycan::HighMannose*>(glycan) != nullptr)
+            return kHighMannose;
+        return kComplex;
+    }
+
+    static std::unique_ptr<model::glycan::Glycan> NewGlycan(int type)
+    {
+        switch (type)
+        {
+        case kHybrid:
+            return std::make_unique<model::glycan::NGlycanHybrid>();
+        case kHighMannose:
+            return std::make_unique<model::glycan::HighMannose>();
+        default:
+            return std::make_unique<model::glycan::NGlycanComplex>();
+        }
+    }
+
+    static void Clear(PeptideSet& set)
+    {
+        set.peptides = engine::protein::PeptideViews();
+        set.masses = nullptr;
+        set.index.Attach(set.peptides, engine::search::FragmentIndex::Arrays {});
+    }
+
+    static const char* Magic() { return "GLYCODB"; }
+    static const int kMagicSize = 8;
+    static const int kMonosaccharides = 6;
+    static const uint64_t kOffset = 14695981039346656037ULL;
+    static const uint64_t kPrime = 1099511628211ULL;
+
+    static uint64_t Hash(uint64_t hash, const char* data, size_t size)
+    {
+        for(size_t i = 0; i < size; i++)
+        {
+            hash ^= (unsigned char) data[i];
+            hash *= kPrime;
+        }
+        return hash;
+    }
+
+    static uint64_t HashFile(uint64_t hash, const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        char buffer[1 << 16];
+        while (file.good())
+        {
+            file.read(buffer, sizeof(buffer));
+            hash = Hash(hash, buffer, (size_t) file.gcount());
+        }
+        return hash;
+    }
+
+    // an array is the count, the items, then padding to 8 bytes
+    template <class T>
+    static void WriteArray(std::ofstream& out, const T* data, uint64_t size)
+    {
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(reinterpret_cast<const char*>(data), sizeof(T) * size);
+        static const char padding[8] = {0};
+        out.write(padding, (8 - (sizeof(T) * size) % 8) % 8);
+    }
+
+    template <class T>
+    static void WriteArray(std::ofstream& out, const std::vector<T>& data)
+    {
+        WriteArray(out, data.data(), data.size());
+    }
+
+    static void WritePeptideSet(std::ofstream& out, const engine::protein::PeptideViews& peptides, int n_thread)
+    {
+        engine::search::FragmentIndex index;
+        util::parallel::WorkStealingPool pool(n_thread);
+        index.Build(peptides, pool);
+
+        // the distinct sequences in order of residues, as the entries refer to
+        const engine::protein::PeptideViews& sorted = index.PeptidesRef();
+        std::vector<engine::protein::PeptideView> views;
+        std::string chars;
+        for(int i = 0; i < sorted.Size(); i++)
+        {
+            views.push_back(engine::protein::PeptideView{(uint32_t) chars.size(), (uint32_t) sorted.Length(i)});
+            chars.append(sorted.Data(i), sorted.Length(i));
+        }
+        // the masses of the ladders of the index
+        const engine::search::FragmentIndex::Arrays& arrays = index.ArraysRef();
+        WriteArray(out, views);
+        WriteArray(out, chars.data(), chars.size());
+        WriteArray(out, arrays.peptide_masses, sorted.Size());
+
+        WriteArray(out, arrays.entry_peptides, arrays.entry_size);
+        WriteArray(out, arrays.entry_sites, arrays.entry_size);
+        WriteArray(out, arrays.masses, arrays.fragment_size);
+        WriteArray(out, arrays.entries, arrays.fragment_size);
+        WriteArray(out, arrays.ladder_offsets, arrays.entry_size + 1);
+        WriteArray(out, arrays.ladder_masses, arrays.ladder_size);
+    }
+
+    bool LoadFile(const std::string& path, uint64_t key)
+    {
+        if (!file_.Open(path))
+            return false;
+        cursor_ = 0;
+        if (file_.Size() < kMagicSize + 16 ||
+            std::memcmp(file_.Data(), Magic(), kMagicSize) != 0)
+            return false;
+        cursor_ += kMagicSize;
+        const uint32_t* version = reinterpret_cast<const uint32_t*>(file_.Data() + cursor_);
+        const uint64_t* stored = reinterpret_cast<const uint64_t*>(file_.Data() + cursor_ + 8);
+        if (version[0] != kVersion || *stored != key)
+            return false;
+        cursor_ += 16;
+
+        if (!ReadPeptideSet(target_) || !ReadPeptideSet(decoy_))
+            return false;
+
+        uint64_t type_size = 0, glycan_size = 0, table_size = 0, composition_size = 0, 
+            mass_size = 0, child_offset_size = 0, child_size = 0;
+        types_ = ReadArray<int>(type_size);
+        table_offsets_ = ReadArray<int>(glycan_size);
+        tables_ = ReadArray<int>(table_size);
+        compositions_ = ReadArray<int>(composition_size);
+        glycan_masses_ = ReadArray<double>(mass_size);
+        child_offsets_ = ReadArray<int>(child_offset_size);
+        children_ = ReadArray<int>(child_size);
+        if (types_ == nullptr || table_offsets_ == nullptr || tables_ == nullptr || compositions_ == nullptr ||
+            glycan_masses_ == nullptr || child_offsets_ == nullptr || children_ == nullptr)
+            return false;
+        if (glycan_size < 1 || glycan_size - 1 > INT_MAX)
+            return false;
+        uint64_t glycans = glycan_size - 1;
+        if (type_size != glycans || !ValidOffsets(table_offsets_, glycan_size, table_size) ||
+            composition_size != glycans * kMonosaccharides || mass_size != glycans ||
+            child_offset_size != glycan_size || 
+            !ValidOffsets(child_offsets_, child_offset_size, child_size) ||
+            !ValidIndexes(children_, child_size, glycans))
+            return false;
+        // the table of a glycan is of the size of its type
+        int table_sizes[kGlycanTypes];
+        for(int t = 0; t < kGlycanTypes; t++)
+        {
+            table_sizes[t] = (int) NewGlycan(t)->TableConst().size();
+        }
+        for(uint64_t i = 0; i < glycans; i++)
+        {
+            if (types_[i] < 0 || types_[i] >= kGlycanTypes ||
+                table_offsets_[i + 1] - table_offsets_[i] != table_sizes[types_[i]])
+                return false;
+        }
+        glycan_size_ = (int) glycans;
+        return true;
+    }
+
+    // offsets from 0, not decreasing, upto the size of the array they index
+    template <class T>
+    static bool ValidOffsets(const T* offsets, uint64_t size, uint64_t last)
+    {
+        if (size < 1 || offsets[0] != 0 || (uint64_t) offsets[size - 1] != last)
+            return false;
+        for(uint64_t i = 1; i < size; i++)
+        {
+            if (offsets[i] < offsets[i - 1])
+                return false;
+        }
+        return true;
+    }
+
+    // indexes in [0, bound)
+    static bool ValidIndexes(const int* indexes, uint64_t size, uint64_t bound)
+    {
+        for(uint64_t i = 0; i < size; i++)
+        {
+            if (indexes[i] < 0 || (uint64_t) indexes[i] >= bound)
+                return false;
+        }
+        return true;
+    }
+
+    template <class T>
+    const T* ReadArray(uint64_t& size)
+    {
+        if (cursor_ + sizeof(uint64_t) > file_.Size())
+            return nullptr;
+        size = *reinterpret_cast<const uint64_t*>(file_.Data() + cursor_);
+        cursor_ += sizeof(uint64_t);
+        if (size > (file_.Size() - cursor_) / sizeof(T))
+            return nullptr;
+        const T* data = reinterpret_cast<const T*>(file_.Data() + cursor_);
+        cursor_ += sizeof(T) * size + (8 - (sizeof(T) * size) % 8) % 8;
+        return data;
+    }
+
+    bool ReadPeptideSet(PeptideSet& set)
+    {
+        uint64_t size = 0, n = 0, mass_size = 0;
+        const engine::protein::PeptideView* views = ReadArray<engine::protein::PeptideView>(size);
+        const char* chars = ReadArray<char>(n);
+        set.masses = ReadArray<double>(mass_size);
+        if (views == nullptr || chars == nullptr || set.masses == nullptr || 
+            mass_size != size || size > INT_MAX)
+            return false;
+        for(uint64_t i = 0; i < size; i++)
+        {
+            if ((uint64_t) views[i].offset + views[i].length > n)
+                return false;
+        }
+        set.peptides = engine::protein::PeptideViews(chars, views, (int) size);
+        if (!set.peptides.Sorted())
+            return false;
+
+        engine::search::FragmentIndex::Arrays arrays;
+        uint64_t entry_size = 0, site_size = 0, fragment_size = 0, fragment_entry_size = 0,
+            ladder_offset_size = 0, ladder_size = 0;
+        arrays.entry_peptides = ReadArray<int>(entry_size);
+        arrays.entry_sites = ReadArray<int>(site_size);
+        arrays.masses = ReadArray<double>(fragment_size);
+        arrays.entries = ReadArray<int>(fragment_entry_size);
+        arrays.ladder_offsets = ReadArray<int>(ladder_offset_size);
+        arrays.ladder_masses = ReadArray<double>(ladder_size);
+        if (arrays.entry_peptides == nullptr || arrays.entry_sites == nullptr ||
+            arrays.masses == nullptr || arrays.entries == nullptr ||
+            arrays.ladder_offsets == nullptr || arrays.ladder_masses == nullptr)
+            return false;
+        if (entry_size > INT_MAX || fragment_size > INT_MAX || ladder_size > INT_MAX ||
+            site_size != entry_size || fragment_entry_size != fragment_size ||
+            ladder_offset_size != entry_size + 1 ||
+            !ValidIndexes(arrays.entry_peptides, entry_size, size) ||
+            !ValidIndexes(arrays.entries, fragment_size, entry_size) ||
+            !ValidOffsets(arrays.ladder_offsets, ladder_offset_size, ladder_size))
+            return false;
+        // the entries in order of peptides, at a residue of the peptide
+        for(uint64_t e = 0; e < entry_size; e++)
+        {
+            if ((e > 0 && arrays.entry_peptides[e] < arrays.entry_peptides[e - 1]) ||
+                arrays.entry_sites[e] < 0 || 
+                arrays.entry_sites[e] >= set.peptides.Length(arrays.entry_peptides[e]))
+                return false;
+        }
+        arrays.entry_size = (int) entry_size;
+        arrays.fragment_size = (int) fragment_size;
+        arrays.ladder_size = (int) ladder_size;
+        arrays.peptide_masses = set.masses;
+        set.index.Attach(set.peptides, arrays);
+        return true;
+    }
+
+    util::io::MappedFile file_;
+    size_t cursor_ = 0;
+    PeptideSet target_;
+    PeptideSet decoy_;
+    int glycan_size_ = 0;
+    const int* types_ = nullptr;
+    const int* table_offsets_ = nullptr;
+    const int* tables_ = nullptr;
+    const int* compositions_ = nullptr;
+    const double* glycan_masses_ = nullptr;
+    const int* child_offsets_ = nullptr;
+    const int* children_ = nullptr;
+};
+
+#endif
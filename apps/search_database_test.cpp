@@ -0,0 +1,82 @@
+#define BOOST_TEST_MODULE SearchDatabaseTest
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <cstdio>
+#include <typeinfo>
+#include <unistd.h>
+
+#include "search_database.h"
+
+// the database with the offset of the glycan types in the file
+class DatabaseFile : public SearchDatabase
+{
+public:
+    long TypesOffset() const
+    {
+        return (long) (reinterpret_cast<const char*>(types_) - file_.Data());
+    }
+};
+
+void WriteType(const std::string& path, long offset, int type)
+{
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char*>(&type), sizeof(type));
+}
+
+BOOST_AUTO_TEST_CASE( search_database_test )
+{
+    SearchParameter parameter;
+    parameter.hexNAc_upper_bound = 4;
+    parameter.hex_upper_bound = 6;
+    parameter.fuc_upper_bound = 1;
+    parameter.neuAc_upper_bound = 1;
+    engine::glycan::GlycanBuilder builder(parameter.hexNAc_upper_bound,
+        parameter.hex_upper_bound, parameter.fuc_upper_bound,
+            parameter.neuAc_upper_bound, parameter.neuGc_upper_bound, true, true, true);
+    builder.Build();
+
+    std::vector<std::string> peptides {"NASNKTAVR", "LPNGTEK", "AVNKSTR"}, decoys {"KETGNPL"};
+    engine::protein::PeptideStore store, decoy_store;
+    for(const auto& seq : peptides)
+    {
+        store.Insert(seq.data(), seq.length());
+    }
+    decoy_store.Insert(decoys[0].data(), decoys[0].length());
+    std::string path = "/tmp/search_database_test_" + std::to_string(getpid()) + ".db";
+    BOOST_CHECK(SearchDatabase::Write(path, 1, store.Views(), decoy_store.Views(), builder, 2));
+
+    // the peptides are views in order, the glycans of the kinds written
+    DatabaseFile database;
+    BOOST_CHECK(database.Load(path, 1));
+    const engine::protein::PeptideViews& loaded = database.Target().peptides;
+    BOOST_CHECK(loaded.Size() == 3);
+    BOOST_CHECK(loaded.Peptide(0) == "AVNKSTR" && loaded.Peptide(2) == "NASNKTAVR");
+    BOOST_CHECK(loaded.Find("LPNGTEK", 7) == 1);
+    BOOST_CHECK(database.Target().index.Entries("NASNKTAVR").second -
+        database.Target().index.Entries("NASNKTAVR").first == 2);
+    std::unique_ptr<engine::glycan::GlycanBuilder> restored = database.Builder(parameter);
+    const std::vector<model::glycan::Glycan*>& glycans = builder.GlycanListRef();
+    const std::vector<model::glycan::Glycan*>& restored_glycans = restored->GlycanListRef();
+    BOOST_CHECK(restored_glycans.size() == glycans.size());
+    int hybrid = -1;
+    for(int i = 0; i < (int) glycans.size(); i++)
+    {
+        BOOST_CHECK(typeid(*restored_glycans[i]) == typeid(*glycans[i]));
+        BOOST_CHECK(restored_glycans[i]->ID() == glycans[i]->ID());
+        if (hybrid < 0 && typeid(*glycans[i]) == typeid(model::glycan::NGlycanHybrid))
+            hybrid = i;
+    }
+    BOOST_CHECK(hybrid >= 0);
+
+    // a type of another table size, or of no kind, is refused
+    long offset = database.TypesOffset() + hybrid * (long) sizeof(int);
+    database.Load("", 1);
+    WriteType(path, offset, SearchDatabase::kComplex);
+    BOOST_CHECK(!database.Load(path, 1));
+    WriteType(path, offset, SearchDatabase::kGlycanTypes);
+    BOOST_CHECK(!database.Load(path, 1));
+    WriteType(path, offset, SearchDatabase::kHybrid);
+    BOOST_CHECK(database.Load(path, 1));
+    std::remove(path.c_str());
+}
@@ -1,145 +1,814 @@
 #ifndef APP_SEARCH_WORK_DISTRIBUTOR_H_
 #define APP_SEARCH_WORK_DISTRIBUTOR_H_
 
-#include <deque>
-#include <thread>  
-#include <mutex> 
+#include <vector>
+#include <memory>
+#include <chrono> 
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cassert>
 
 #include "search_parameter.h"
+#include "search_telemetry.h"
+#include "search_writer.h"
 #include "../algorithm/search/bucket_search.h"
 #include "../engine/glycan/glycan_builder.h"
 #include "../engine/analysis/search_analyzer.h"
 #include "../engine/search/precursor_match.h"
 #include "../engine/search/search_glycan.h"
 #include "../engine/search/search_sequence.h"
+#include "../engine/search/fragment_index.h"
+#include "../engine/spectrum/oxonium_filter.h"
+#include "../util/parallel/work_stealing_pool.h"
+#include "../util/parallel/bounded_queue.h"
 
-class SearchQueue
+class SearchDispatcher
 {
 public:
-    SearchQueue(const std::vector<model::spectrum::Spectrum>& spectra)
-        { GenerateQueue(spectra); }
+    SearchDispatcher(
+        engine::glycan::GlycanBuilder* builder, const std::vector<std::string>& peptides, 
+            SearchParameter parameter): builder_(builder), parameter_(parameter)
+    {
+        libraries_.push_back(std::make_unique<Library>(peptides, false));
+    }
 
-    SearchQueue(const SearchQueue& other)
+    // peptides as views into an arena that outlives the dispatcher
+    SearchDispatcher(
+        engine::glycan::GlycanBuilder* builder, const engine::protein::PeptideViews& peptides, 
+            SearchParameter parameter): builder_(builder), parameter_(parameter)
     {
-        queue_ = other.queue_;
+        libraries_.push_back(std::make_unique<Library>(peptides, false));
     }
 
-    void GenerateQueue(
-        std::vector<model::spectrum::Spectrum> spectra)
+    // results of the target and the decoy peptides in one pass,
+    // split by SearchResult::Decoy. The indexes are built at the first 
+    // dispatch and reused by the next, e.g., of other spectrum files.
+    std::vector<engine::analysis::SearchResult> Dispatch(
+        const std::vector<model::spectrum::Spectrum>& spectra)
     {
-        for(const auto& it : spectra)
+        std::vector<engine::analysis::SearchResult> results;
+        if (pool_ == nullptr)
         {
-            queue_.push_back(it);
+            own_pool_ = std::make_unique<util::parallel::WorkStealingPool>(parameter_.n_thread);
+            pool_ = own_pool_.get();
+        }
+        for(auto& library : libraries_)
+        {
+            if (library->precursor_runner == nullptr)
+                Prepare(*library, *pool_);
+        }
+
+        // a worker builds its searchers at its first chunk, kept for the next dispatch
+        if (workers_.size() != (size_t) pool_->Size())
+            workers_.resize(pool_->Size());
+        if (parameter_.pipeline.empty())
+        {
+            SearchProgress progress((int) spectra.size(), pool_->Size(), progress_interval_);
+            pool_->Run((int) spectra.size(), [this, &spectra, &progress](int w, int first, int last)
+            {
+                if (workers_[w] == nullptr)
+                    workers_[w] = CreateWorker();
+                size_t written = workers_[w]->results.size();
+                for(int i = first; i < last; i++)
+                {
+                    SearchingWorker(spectra[i], *workers_[w]);
+                }
+                Write(*workers_[w], written);
+                progress.Done(w, last - first);
+            });
         }
+        else
+        {
+            SearchProgress progress((int) spectra.size(), parameter_.pipeline.back(), progress_interval_);
+            SearchingPipeline(spectra, progress);
+        }
+        std::vector<Worker*> active;
+        for(const auto& worker : workers_)
+        {
+            if (worker != nullptr)
+                active.push_back(worker.get());
+        }
+        for(const auto& worker : stage_workers_)
+        {
+            if (worker != nullptr)
+                active.push_back(worker.get());
+        }
+
+        // spectra over the budget, searched by all the workers in turn
+        if (parameter_.deferred_pass)
+        {
+            std::vector<const model::spectrum::Spectrum*> deferred;
+            for(const auto& worker : active)
+            {
+                deferred.insert(deferred.end(), worker->deferred.begin(), worker->deferred.end());
+            }
+            std::sort(deferred.begin(), deferred.end());
+            for(const auto& spectrum : deferred)
+            {
+                std::vector<engine::analysis::SearchResult> searched = SearchingDeferred(*spectrum);
+                if (writer_ != nullptr)
+                    writer_->Push(searched);
+                results.insert(results.end(), searched.begin(), searched.end());
+            }
+        }
+
+        for(const auto& worker : active)
+        {
+            results.insert(results.end(), worker->results.begin(), worker->results.end());
+            searched_ += worker->searched;
+            skipped_ += worker->skipped;
+            telemetry_.Merge(worker->telemetry);
+            worker->Reset();
+        }
+        return results;
+    }
+
+    // options of the next dispatches, set on the workers in place,
+    // as a job of the server may override them
+    void set_ms2_tol(double tol)
+    {
+        if (tol == parameter_.ms2_tol)
+            return;
+        parameter_.ms2_tol = tol;
+        ForEachWorker([tol](Worker& worker) { worker.set_ms2_tol(tol); });
+    }
+
+    void set_top_k(int top_k)
+    {
+        assert(top_k >= 1);
+        if (top_k == parameter_.top_k)
+            return;
+        parameter_.top_k = top_k;
+        ForEachWorker([top_k](Worker& worker)
+        {
+            worker.analyzer->set_top_k(top_k);
+            worker.spectrum_searcher->set_top_k(top_k);
+        });
     }
 
-    model::spectrum::Spectrum TryGetSpectrum()
+    const SearchParameter& Parameter() const { return parameter_; }
+
+    // a progress line on stderr every interval of seconds during a dispatch, 0 disables
+    void set_progress(double interval) { progress_interval_ = interval; }
+
+    // the matches are pushed to the writer as the workers find them, optional
+    void set_writer(SearchWriter* writer) { writer_ = writer; }
+
+    // the queue operations of the glycan dp per spectrum, for a run of one thread
+    void set_queue_trace(std::vector<std::vector<double>>* traces)
+    {
+        traces_ = traces;
+        ClearWorkers();
+    }
+
+    // threads shared with others, otherwise the dispatcher keeps its own
+    void set_pool(util::parallel::WorkStealingPool* pool) { pool_ = pool; }
+
+    // peptide masses and fragment index from the search database
+    void set_database(const double* masses, const engine::search::FragmentIndex* index)
+    {
+        libraries_.front()->masses = masses;
+        libraries_.front()->index = index;
+        ClearWorkers();
+    }
+
+    // decoy peptides searched along with the targets, sharing the per spectrum work
+    void set_decoy(const std::vector<std::string>& peptides)
     {
-        model::spectrum::Spectrum spec;
-        mutex_.lock();
-            if (! queue_.empty())
+        libraries_.resize(1);
+        libraries_.push_back(std::make_unique<Library>(peptides, true));
+        ClearWorkers();
+    }
+
+    void set_decoy(const engine::protein::PeptideViews& peptides, 
+        const double* masses=nullptr, const engine::search::FragmentIndex* index=nullptr)
+    {
+        libraries_.resize(1);
+        libraries_.push_back(std::make_unique<Library>(peptides, true));
+        libraries_.back()->masses = masses;
+        libraries_.back()->index = index;
+        ClearWorkers();
+    }
+
+    // stage timers and candidate counts of the dispatches so far
+    const SearchTelemetry& Telemetry() const { return telemetry_; }
+
+    // triage counters of the run
+    int Searched() const { return searched_; }
+    // peak nodes created by the glycan dp
+    long Expanded() const { return telemetry_.Expanded(); }
+    int Skipped() const { return skipped_; }
+    // worker seconds, estimated by the average searching time of the accepted spectra
+    double SavedSeconds() const
+    { 
+        if (searched_ == 0)
+            return 0;
+        double searching_seconds = 0;
+        for(int s = SearchTelemetry::kPrecursor; s <= SearchTelemetry::kFilter; s++)
+        {
+            searching_seconds += telemetry_.Stat(static_cast<SearchTelemetry::Stage>(s)).seconds;
+        }
+        return skipped_ * searching_seconds / searched_ - 
+            telemetry_.Stat(SearchTelemetry::kOxonium).seconds; 
+    }
+
+protected:
+    // peptides of target or decoy, with the indexes shared read-only by the workers
+    struct Library
+    {
+        Library(const engine::protein::PeptideViews& peptides, bool decoy): 
+            peptides(peptides), decoy(decoy){}
+
+        // duplicated peptides once, copied to the arena of the library
+        Library(const std::vector<std::string>& strings, bool decoy): decoy(decoy)
+        {
+            for(const auto& seq : strings)
             {
-                spec = queue_.front();
-                queue_.pop_front();
+                store.Insert(seq.data(), seq.length());
             }
-            else
+            peptides = store.Views();
+        }
+
+        engine::protein::PeptideStore store;
+        engine::protein::PeptideViews peptides;
+        bool decoy;
+        // prebuilt by the search database, aligned with peptides
+        const double* masses = nullptr;
+        const engine::search::FragmentIndex* index = nullptr;
+        engine::search::FragmentIndex built_index;
+        std::unique_ptr<engine::search::PrecursorMatcher> precursor_runner;
+    };
+
+    // searchers and results of a pool thread
+    struct Worker
+    {
+        // a sequencer per library, as each keeps the stamps of its fragment index
+        std::vector<std::unique_ptr<engine::search::SequenceSearch>> spectrum_sequencers;
+        std::unique_ptr<engine::search::GlycanSearch> spectrum_searcher;
+        std::unique_ptr<engine::spectrum::OxoniumFilter> oxonium_filter;
+        std::unique_ptr<engine::analysis::SearchAnalyzer> analyzer;
+        // a ladder per peptide, for the masses and ions of the searchers
+        util::mass::PeptideLadders ladders;
+        std::vector<engine::analysis::SearchResult> results;
+        std::vector<const model::spectrum::Spectrum*> deferred;
+        int searched = 0;
+        int skipped = 0;
+        SearchTelemetry telemetry;
+
+        void set_ms2_tol(double tol)
+        {
+            for(const auto& sequencer : spectrum_sequencers)
             {
-                spec.set_scan(-1);
+                sequencer->set_tolerance(tol);
             }
-        mutex_.unlock();
-        return spec;
+            spectrum_searcher->set_tolerance(tol);
+            oxonium_filter->set_tolerance(tol);
+        }
+
+        void Reset()
+        {
+            results.clear();
+            deferred.clear();
+            searched = 0;
+            skipped = 0;
+            telemetry.Reset();
+        }
+    };
+
+    // a spectrum passing the pipeline, with the matches of each library so far
+    struct PipelineItem
+    {
+        const model::spectrum::Spectrum* spectrum;
+        // skipped, deferred, or without candidates left
+        bool done = false;
+        std::vector<std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>> candidates;
+        std::vector<std::unordered_map<std::string, std::unordered_set<int>>> peptide_results;
+        std::vector<std::unordered_map<std::string, std::unordered_set<int>>> glycan_results;
+    };
+    typedef std::vector<PipelineItem> PipelineBatch;
+    typedef util::parallel::BoundedQueue<std::unique_ptr<PipelineBatch>> PipelineQueue;
+    enum PipelineStage { kPrecursorStage, kSequenceStage, kGlycanStage, kAnalyzeStage, kPipelineStages };
+
+    // matches of the worker from the position on
+    void Write(Worker& worker, size_t from)
+    {
+        if (writer_ == nullptr || worker.results.size() == from)
+            return;
+        writer_->Push(std::vector<engine::analysis::SearchResult>(
+            worker.results.begin() + from, worker.results.end()));
     }
-    
 
+    void ClearWorkers()
+    {
+        workers_.clear();
+        stage_workers_.clear();
+    }
 
-protected:
-    std::deque<model::spectrum::Spectrum> queue_;
-    std::mutex mutex_; 
-};
+    template <class Visit>
+    void ForEachWorker(Visit visit)
+    {
+        for(const auto& worker : workers_)
+        {
+            if (worker != nullptr)
+                visit(*worker);
+        }
+        for(const auto& worker : stage_workers_)
+        {
+            if (worker != nullptr)
+                visit(*worker);
+        }
+    }
 
+    // each stage runs on its own threads, with a worker per thread kept for the
+    // next dispatch, and passes batches of spectra to the next by a bounded queue
+    void SearchingPipeline(const std::vector<model::spectrum::Spectrum>& spectra, SearchProgress& progress)
+    {
+        const std::vector<int>& threads = parameter_.pipeline;
+        int n_worker = 0;
+        for(int n : threads)
+        {
+            n_worker += n;
+        }
+        if ((int) stage_workers_.size() != n_worker)
+        {
+            stage_workers_.clear();
+            stage_workers_.resize(n_worker);
+        }
 
+        std::vector<std::unique_ptr<PipelineQueue>> queues;
+        std::unique_ptr<std::atomic<int>[]> running(new std::atomic<int>[kPipelineStages]);
+        for(int s = 0; s < kPipelineStages; s++)
+        {
+            queues.push_back(std::make_unique<PipelineQueue>(kPipelineQueue));
+            running[s].store(threads[s]);
+        }
+        std::atomic<int> next {0};
+        int size = (int) spectra.size();
 
-class SearchDispatcher
-{
-public:
-    SearchDispatcher(
-        const std::vector<model::spectrum::Spectrum>& spectra, 
-        engine::glycan::GlycanBuilder* builder, const std::vector<std::string>& peptides, 
-            SearchParameter parameter): queue_(SearchQueue(spectra)), builder_(builder), 
-                peptides_(peptides), parameter_(parameter){}
+        std::vector<std::thread> stage_threads;
+        int w = 0;
+        for(int s = 0; s < kPipelineStages; s++)
+        {
+            for(int t = 0; t < threads[s]; t++, w++)
+            {
+                stage_threads.push_back(std::thread([&, s, t, w]
+                {
+                    if (stage_workers_[w] == nullptr)
+                        stage_workers_[w] = CreateWorker();
+                    Worker& worker = *stage_workers_[w];
+                    std::unique_ptr<PipelineBatch> batch;
+                    if (s == kPrecursorStage)
+                    {
+                        int first;
+                        while ((first = next.fetch_add(kPipelineBatch)) < size)
+                        {
+                            batch = std::make_unique<PipelineBatch>(std::min((int) kPipelineBatch, size - first));
+                            for(int i = 0; i < (int) batch->size(); i++)
+                            {
+                                (*batch)[i].spectrum = &spectra[first + i];
+                                PipelinePrecursor((*batch)[i], worker);
+                            }
+                            queues[s]->Push(std::move(batch));
+                        }
+                    }
+                    else
+                    {
+                        while (queues[s - 1]->Pop(batch))
+                        {
+                            size_t written = worker.results.size();
+                            for(auto& item : *batch)
+                            {
+                                if (item.done)
+                                    continue;
+                                if (s == kSequenceStage)
+                                    PipelineSequence(item, worker);
+                                else if (s == kGlycanStage)
+                                    PipelineGlycan(item, worker);
+                                else
+                                    PipelineAnalyze(item, worker);
+                            }
+                            if (s == kAnalyzeStage)
+                            {
+                                Write(worker, written);
+                                progress.Done(t, (int) batch->size());
+                            }
+                            else
+                                queues[s]->Push(std::move(batch));
+                        }
+                    }
+                    if (running[s].fetch_sub(1) == 1)
+                        queues[s]->Close();
+                }));
+            }
+        }
+        for(auto& thread : stage_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void PipelinePrecursor(PipelineItem& item, Worker& worker)
+    {
+        const model::spectrum::Spectrum& spectrum = *item.spectrum;
+        worker.telemetry.add_spectra(1);
+        if (parameter_.oxonium_filter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            bool accept = worker.oxonium_filter->Accept(spectrum.Peaks());
+            worker.telemetry.Add(SearchTelemetry::kOxonium, start, accept ? 1 : 0);
+            if (!accept)
+            {
+                worker.skipped++;
+                item.done = true;
+                return;
+            }
+        }
+        worker.searched++;
 
+        item.done = true;
+        for(const auto& library : libraries_)
+        {
+            auto start = std::chrono::steady_clock::now();
+            item.candidates.push_back(library->precursor_runner->Match(
+                spectrum.PrecursorMZ(), spectrum.PrecursorCharge()));
+            long pairs = 0;
+            for(const auto& it : item.candidates.back())
+            {
+                pairs += (long) it.second.size();
+            }
+            worker.telemetry.Add(SearchTelemetry::kPrecursor, start, pairs);
+            if (pairs > 0)
+                item.done = false;
+            if (parameter_.budget_candidates > 0 && pairs > parameter_.budget_candidates)
+            {
+                PipelineDefer(item, worker);
+                return;
+            }
+        }
+    }
 
-    std::vector<engine::analysis::SearchResult> Dispatch()
+    void PipelineSequence(PipelineItem& item, Worker& worker)
     {
-        std::vector<engine::analysis::SearchResult> results;
-        std::vector< std::thread> thread_pool;
-        for (int i = 0; i < parameter_.n_thread; i ++)
+        const model::spectrum::Spectrum& spectrum = *item.spectrum;
+        item.done = true;
+        for(int l = 0; l < (int) libraries_.size(); l++)
+        {
+            item.peptide_results.push_back(std::unordered_map<std::string, std::unordered_set<int>>());
+            if (item.candidates[l].empty()) continue;
+            auto start = std::chrono::steady_clock::now();
+            item.peptide_results[l] = worker.spectrum_sequencers[l]->Search(
+                spectrum.Peaks(), spectrum.PrecursorCharge(), item.candidates[l]);
+            worker.telemetry.Add(SearchTelemetry::kSequence, start, (long) item.peptide_results[l].size());
+            if (!item.peptide_results[l].empty())
+                item.done = false;
+        }
+    }
+
+    void PipelineGlycan(PipelineItem& item, Worker& worker)
+    {
+        const model::spectrum::Spectrum& spectrum = *item.spectrum;
+        bool prepared = false;
+        item.done = true;
+        for(int l = 0; l < (int) libraries_.size(); l++)
         {
-            std::thread worker(&SearchDispatcher::SearchingWorker, this, std::ref(results));
-            thread_pool.push_back(std::move(worker));
+            item.glycan_results.push_back(std::unordered_map<std::string, std::unordered_set<int>>());
+            if (item.peptide_results[l].empty()) continue;
+            auto start = std::chrono::steady_clock::now();
+            if (!prepared)
+            {
+                worker.spectrum_searcher->Prepare(spectrum.Peaks(), spectrum.PrecursorCharge());
+                prepared = true;
+            }
+            long expanded = worker.spectrum_searcher->Expanded();
+            item.glycan_results[l] = worker.spectrum_searcher->SearchPrepared(spectrum.Peaks(), 
+                item.candidates[l], &item.peptide_results[l]);
+            worker.telemetry.Add(SearchTelemetry::kGlycan, start, (long) item.glycan_results[l].size());
+            worker.telemetry.add_expanded(spectrum.Scan(), worker.spectrum_searcher->Expanded() - expanded);
+            if (worker.spectrum_searcher->Exceeded())
+            {
+                PipelineDefer(item, worker);
+                return;
+            }
+            if (!item.glycan_results[l].empty())
+                item.done = false;
         }
-        for (auto& worker : thread_pool)
+    }
+
+    void PipelineAnalyze(PipelineItem& item, Worker& worker)
+    {
+        const model::spectrum::Spectrum& spectrum = *item.spectrum;
+        worker.analyzer->Prepare(spectrum.Peaks());
+        for(int l = 0; l < (int) libraries_.size(); l++)
         {
-            worker.join();
+            if (item.glycan_results[l].empty()) continue;
+            SearchTelemetry& telemetry = worker.telemetry;
+            auto start = std::chrono::steady_clock::now();
+            auto searched = worker.analyzer->AnalyzePrepared(spectrum.Scan(), 
+                item.peptide_results[l], item.glycan_results[l]);
+            telemetry.Add(SearchTelemetry::kAnalyze, start, (long) searched.size());
+            searched = worker.analyzer->Filter(searched, builder_->GlycanMapsRef(), 
+                spectrum.PrecursorMZ(), spectrum.PrecursorCharge());
+            telemetry.Add(SearchTelemetry::kFilter, start, (long) searched.size());
+            for(auto& it : searched)
+            {
+                it.set_decoy(libraries_[l]->decoy);
+            }
+            worker.results.insert(worker.results.end(), searched.begin(), searched.end());
         }
-        return results;
     }
 
-protected:
-    void SearchingWorker(
-        std::vector<engine::analysis::SearchResult>& results)
-    {
-        std::unique_ptr<algorithm::search::ISearch<std::string>> searcher =
-            std::make_unique<algorithm::search::BucketSearch<std::string>>(parameter_.ms1_by, parameter_.ms1_tol);
-        
-        std::unique_ptr<algorithm::search::ISearch<std::string>> more_searcher =
-            std::make_unique<algorithm::search::BucketSearch<std::string>>(parameter_.ms2_by, parameter_.ms2_tol);    
+    void PipelineDefer(PipelineItem& item, Worker& worker)
+    {
+        item.done = true;
+        worker.deferred.push_back(item.spectrum);
+        worker.telemetry.add_deferred(item.spectrum->Scan());
+    }
+
+    void Prepare(Library& library, util::parallel::WorkStealingPool& pool)
+    {
+        if (parameter_.fragment_index && library.index == nullptr)
+        {
+            library.built_index.Build(library.peptides, pool);
+            library.index = &library.built_index;
+        }
+
+        // precursor index, with the masses of the peptide ladders, of the
+        // fragment index or set by the pool
+        engine::protein::PeptideViews peptides = library.peptides;
+        const double* peptide_masses = library.masses;
+        if (peptide_masses == nullptr && library.index != nullptr)
+        {
+            peptides = library.index->PeptidesRef();
+            peptide_masses = library.index->ArraysRef().peptide_masses;
+        }
+        std::vector<double> masses;
+        if (peptide_masses == nullptr)
+        {
+            masses.resize(peptides.Size());
+            pool.Run(peptides.Size(), [&peptides, &masses](int w, int first, int last)
+            {
+                util::mass::PeptideLadder ladder;
+                for(int i = first; i < last; i++)
+                {
+                    ladder.Set(peptides.Data(i), peptides.Length(i));
+                    masses[i] = ladder.Mass();
+                }
+            });
+            peptide_masses = masses.data();
+        }
+        std::unique_ptr<algorithm::search::ISearch<int>> searcher =
+            std::make_unique<algorithm::search::BucketSearch<int>>(parameter_.ms1_by, parameter_.ms1_tol);
+        library.precursor_runner = std::make_unique<engine::search::PrecursorMatcher>(std::move(searcher));
+        library.precursor_runner->Init(peptides, peptide_masses, builder_->GlycanMapsRef());
+    }
+
+    std::unique_ptr<Worker> CreateWorker()
+    {
+        std::unique_ptr<Worker> worker = std::make_unique<Worker>();
+        for(const auto& library : libraries_)
+        {
+            std::unique_ptr<algorithm::search::ISearch<std::string>> more_searcher =
+                std::make_unique<algorithm::search::BucketSearch<std::string>>(parameter_.ms2_by, parameter_.ms2_tol);    
+            worker->spectrum_sequencers.push_back(
+                std::make_unique<engine::search::SequenceSearch>(std::move(more_searcher)));
+            worker->spectrum_sequencers.back()->set_ladders(&worker->ladders);
+            if (parameter_.fragment_index)
+                worker->spectrum_sequencers.back()->set_fragment_index(library->index, 
+                    parameter_.ms2_by, parameter_.ms2_tol);
+        }
+
         std::unique_ptr<algorithm::search::ISearch<int>> extra_searcher =
             std::make_unique<algorithm::search::BucketSearch<int>>(parameter_.ms2_by, parameter_.ms2_tol);
-    
+        worker->spectrum_searcher = std::make_unique<engine::search::GlycanSearch>(std::move(extra_searcher), 
+            builder_->GlycanMapsRef(), parameter_.complex, parameter_.hybrid, parameter_.highmannose);
+        engine::search::GlycanSearch& spectrum_searcher = *worker->spectrum_searcher;
+        spectrum_searcher.set_ladders(&worker->ladders);
+        spectrum_searcher.set_subsumption(builder_->Subsumption());
+        if (parameter_.shift_match)
+            spectrum_searcher.set_shift_match(&builder_->MassListRef(), 
+                parameter_.ms2_by, parameter_.ms2_tol);
+        // the branch and bound is of the lattice sweep
+        if (parameter_.sweep || parameter_.branch_bound)
+            spectrum_searcher.set_dag(&builder_->DAGRef());
+        spectrum_searcher.set_bucket_queue(parameter_.bucket_queue);
+        spectrum_searcher.set_tolerance_by(parameter_.ms2_by);
+        spectrum_searcher.set_branch_bound(parameter_.branch_bound);
+        spectrum_searcher.set_top_k(parameter_.top_k);
+        spectrum_searcher.set_beam_width(parameter_.beam_width);
+        spectrum_searcher.set_budget(parameter_.budget_nodes, parameter_.budget_seconds);
+        spectrum_searcher.set_trace(traces_);
 
-        engine::search::PrecursorMatcher precursor_runner(std::move(searcher));
-        precursor_runner.Init(peptides_, builder_->GlycanMapsRef());
+        worker->oxonium_filter = std::make_unique<engine::spectrum::OxoniumFilter>(parameter_.ms2_by, 
+            parameter_.ms2_tol, parameter_.oxonium_relative_intensity, parameter_.oxonium_min_count);
+        worker->analyzer = std::make_unique<engine::analysis::SearchAnalyzer>(parameter_.top_k);
+        return worker;
+    }
 
-        engine::search::SequenceSearch spectrum_sequencer(std::move(more_searcher));
-        engine::search::GlycanSearch spectrum_searcher(std::move(extra_searcher), builder_->GlycanMapsRef(),
-            parameter_.complex, parameter_.hybrid, parameter_.highmannose);
+    void SearchingWorker(const model::spectrum::Spectrum& spectrum, Worker& worker)
+    {
+        // oxonium ions
+        worker.telemetry.add_spectra(1);
+        if (parameter_.oxonium_filter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            bool accept = worker.oxonium_filter->Accept(spectrum.Peaks());
+            worker.telemetry.Add(SearchTelemetry::kOxonium, start, accept ? 1 : 0);
+            if (!accept)
+            {
+                worker.skipped++;
+                return;
+            }
+        }
+        worker.searched++;
+        long expanded = worker.spectrum_searcher->Expanded();
+        bool searched = SearchingSpectrum(spectrum, worker);
+        worker.telemetry.add_expanded(spectrum.Scan(), worker.spectrum_searcher->Expanded() - expanded);
+        if (!searched)
+        {
+            worker.deferred.push_back(&spectrum);
+            worker.telemetry.add_deferred(spectrum.Scan());
+        }
+    }
 
-        std::vector<engine::analysis::SearchResult> temp_result;
-        engine::analysis::SearchAnalyzer analyzer;
-        
-        while (true)
+    // false if the spectrum is over the budget, with nothing reported
+    bool SearchingSpectrum(const model::spectrum::Spectrum& spectrum, Worker& worker)
+    {
+        // the peaks are indexed once, by the first library reaching the glycan search
+        std::vector<engine::analysis::SearchResult> found;
+        bool prepared = false;
+        for(int l = 0; l < (int) libraries_.size(); l++)
         {
-            model::spectrum::Spectrum spectrum = queue_.TryGetSpectrum();
-            if (spectrum.Scan() < 0) break;
+            const Library& library = *libraries_[l];
+            SearchTelemetry& telemetry = worker.telemetry;
+            auto start = std::chrono::steady_clock::now();
 
             // precusor
-            auto results = precursor_runner.Match(spectrum.PrecursorMZ(), spectrum.PrecursorCharge());
+            auto results = library.precursor_runner->Match(spectrum.PrecursorMZ(), spectrum.PrecursorCharge());
+            long pairs = 0;
+            for(const auto& it : results)
+            {
+                pairs += (long) it.second.size();
+            }
+            telemetry.Add(SearchTelemetry::kPrecursor, start, pairs);
             if (results.empty()) continue;
+            if (parameter_.budget_candidates > 0 && pairs > parameter_.budget_candidates)
+                return false;
 
             // msms
-            auto peptide_results = spectrum_sequencer.Search(spectrum.Peaks(), spectrum.PrecursorCharge(), results);
+            auto peptide_results = worker.spectrum_sequencers[l]->Search(
+                spectrum.Peaks(), spectrum.PrecursorCharge(), results);
+            telemetry.Add(SearchTelemetry::kSequence, start, (long) peptide_results.size());
             if (peptide_results.empty()) continue;
 
-            auto glycan_results = spectrum_searcher.Search(spectrum.Peaks(), spectrum.PrecursorCharge(), results);
+            if (!prepared)
+            {
+                worker.spectrum_searcher->Prepare(spectrum.Peaks(), spectrum.PrecursorCharge());
+                worker.analyzer->Prepare(spectrum.Peaks());
+                prepared = true;
+            }
+            auto glycan_results = worker.spectrum_searcher->SearchPrepared(spectrum.Peaks(), results, &peptide_results);
+            telemetry.Add(SearchTelemetry::kGlycan, start, (long) glycan_results.size());
+            if (worker.spectrum_searcher->Exceeded())
+                return false;
             if (glycan_results.empty()) continue;
 
-            auto searched = analyzer.Analyze(spectrum.Scan(), spectrum.Peaks(), peptide_results, glycan_results);
-            searched = analyzer.Filter(searched, builder_->GlycanMapsRef(), spectrum.PrecursorMZ(), spectrum.PrecursorCharge());
-            temp_result.insert(temp_result.end(), searched.begin(), searched.end());
+            auto searched = worker.analyzer->AnalyzePrepared(spectrum.Scan(), peptide_results, glycan_results);
+            telemetry.Add(SearchTelemetry::kAnalyze, start, (long) searched.size());
+            searched = worker.analyzer->Filter(searched, builder_->GlycanMapsRef(), 
+                spectrum.PrecursorMZ(), spectrum.PrecursorCharge());
+            telemetry.Add(SearchTelemetry::kFilter, start, (long) searched.size());
+            for(auto& it : searched)
+            {
+                it.set_decoy(library.decoy);
+            }
+            found.insert(found.end(), searched.begin(), searched.end());
+        }
+        worker.results.insert(worker.results.end(), found.begin(), found.end());
+        return true;
+    }
+
+    // a deferred spectrum without budget, the workers search shares of the peptides,
+    // cut between masses as the peptides of a mass share the peak nodes of the dp
+    std::vector<engine::analysis::SearchResult> SearchingDeferred(const model::spectrum::Spectrum& spectrum)
+    {
+        std::vector<engine::analysis::SearchResult> found;
+        long expanded = 0;
+        for(const auto& library : libraries_)
+        {
+            auto candidates = library->precursor_runner->Match(spectrum.PrecursorMZ(), spectrum.PrecursorCharge());
+            if (candidates.empty()) continue;
+
+            std::vector<std::pair<double, std::string>> peptides;
+            for(const auto& it : candidates)
+            {
+                peptides.push_back(std::make_pair(deferred_ladders_.Mass(it.first), it.first));
+            }
+            std::sort(peptides.begin(), peptides.end());
+            int size = (int) peptides.size();
+            int n_share = pool_->Size() * kDeferredShares;
+            std::vector<int> bounds {0};
+            for(int i = 1; i <= n_share; i++)
+            {
+                int bound = (int) ((long) size * i / n_share);
+                while (bound < size && bound > 0 && peptides[bound].first == peptides[bound - 1].first)
+                    bound++;
+                if (bound > bounds.back())
+                    bounds.push_back(bound);
+            }
+
+            int l = (int) (&library - &libraries_.front());
+            std::vector<std::vector<engine::analysis::SearchResult>> shares(bounds.size() - 1);
+            std::vector<long> share_expanded(shares.size(), 0);
+            pool_->Run((int) shares.size(), [&](int w, int first, int last)
+            {
+                if (workers_[w] == nullptr)
+                    workers_[w] = CreateWorker();
+                Worker& worker = *workers_[w];
+                worker.spectrum_searcher->set_budget(0, 0);
+                for(int i = first; i < last; i++)
+                {
+                    std::unordered_map<std::string, std::vector<model::glycan::Glycan*>> share;
+                    for(int j = bounds[i]; j < bounds[i + 1]; j++)
+                    {
+                        share.emplace(peptides[j].second, candidates.find(peptides[j].second)->second);
+                    }
+                    auto peptide_results = worker.spectrum_sequencers[l]->Search(
+                        spectrum.Peaks(), spectrum.PrecursorCharge(), share);
+                    if (peptide_results.empty()) continue;
+
+                    worker.spectrum_searcher->Prepare(spectrum.Peaks(), spectrum.PrecursorCharge());
+                    worker.analyzer->Prepare(spectrum.Peaks());
+                    long share_start = worker.spectrum_searcher->Expanded();
+                    auto glycan_results = worker.spectrum_searcher->SearchPrepared(spectrum.Peaks(), share, &peptide_results);
+                    share_expanded[i] = worker.spectrum_searcher->Expanded() - share_start;
+                    if (glycan_results.empty()) continue;
+                    shares[i] = worker.analyzer->AnalyzePrepared(spectrum.Scan(), peptide_results, glycan_results);
+                }
+                worker.spectrum_searcher->set_budget(parameter_.budget_nodes, parameter_.budget_seconds);
+            }, 1);
+            for(const auto& nodes : share_expanded)
+            {
+                expanded += nodes;
+            }
+
+            // the top k scores over the shares, as the analyzer keeps within one
+            std::vector<double> tiers;
+            for(const auto& share : shares)
+            {
+                for(const auto& it : share)
+                {
+                    tiers.push_back(it.Score());
+                }
+            }
+            std::sort(tiers.begin(), tiers.end(), std::greater<double>());
+            tiers.erase(std::unique(tiers.begin(), tiers.end()), tiers.end());
+            if (tiers.empty()) continue;
+            double lowest = tiers[std::min((int) tiers.size(), parameter_.top_k) - 1];
+            std::vector<engine::analysis::SearchResult> searched;
+            for(const auto& share : shares)
+            {
+                for(const auto& it : share)
+                {
+                    if (it.Score() >= lowest)
+                        searched.push_back(it);
+                }
+            }
+
+            engine::analysis::SearchAnalyzer analyzer(parameter_.top_k);
+            searched = analyzer.Filter(searched, builder_->GlycanMapsRef(), 
+                spectrum.PrecursorMZ(), spectrum.PrecursorCharge());
+            for(auto& it : searched)
+            {
+                it.set_decoy(library->decoy);
+            }
+            found.insert(found.end(), searched.begin(), searched.end());
         }
-        
-        mutex_.lock();
-            results.insert(results.end(), temp_result.begin(), temp_result.end());
-        mutex_.unlock();
+        telemetry_.add_expanded(spectrum.Scan(), expanded);
+        return found;
     }
 
-    std::mutex mutex_; 
-    SearchQueue queue_;
+    // shares of the peptides per worker in the deferred pass
+    static const int kDeferredShares = 4;
+    // spectra per batch and batches per queue of the pipeline
+    static const int kPipelineBatch = 8;
+    static const int kPipelineQueue = 64;
+
+    util::parallel::WorkStealingPool* pool_ = nullptr;
+    std::unique_ptr<util::parallel::WorkStealingPool> own_pool_;
     engine::glycan::GlycanBuilder* builder_;
-    std::vector<std::string> peptides_;
+    std::vector<std::unique_ptr<Library>> libraries_; // target, then decoy if any
+    util::mass::PeptideLadders deferred_ladders_; // of the deferred pass
+    std::vector<std::unique_ptr<Worker>> workers_; // by thread of the pool
+    std::vector<std::unique_ptr<Worker>> stage_workers_; // by thread of the pipeline stages
     SearchParameter parameter_;
+    int searched_ = 0;
+    int skipped_ = 0;
+    SearchTelemetry telemetry_;
+    double progress_interval_ = 0;
+    SearchWriter* writer_ = nullptr;
+    std::vector<std::vector<double>>* traces_ = nullptr;
 
 };
 
-#endif
\ No newline at end of file
+#endif
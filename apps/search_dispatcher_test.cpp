@@ -0,0 +1,128 @@
+#define BOOST_TEST_MODULE SearchDispatcherTest
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <tuple>
+#include <algorithm>
+
+#include "search_dispatcher.h"
+#include "../util/mass/peptide.h"
+#include "../util/mass/glycan.h"
+#include "../util/mass/spectrum.h"
+#include "../engine/search/search_helper.h"
+
+// the b, y and Y ions of a glycan on the peptide, of random intensity above 1,
+// the Y ions along a path of growth
+void AddGlycopeptidePeaks(const std::string& peptide, double glycan_mass, std::mt19937& generator,
+    std::vector<model::spectrum::Peak>& peaks)
+{
+    const double kHexNAc = util::mass::GlycanMass::kHexNAc, kHex = util::mass::GlycanMass::kHex;
+    std::uniform_real_distribution<double> intensity(1.0, 10000.0);
+    double peptide_mass = util::mass::PeptideMass::Compute(peptide);
+    std::vector<double> ys {kHexNAc, 2 * kHexNAc, 2 * kHexNAc + kHex, 2 * kHexNAc + 2 * kHex,
+        2 * kHexNAc + 3 * kHex, 3 * kHexNAc + 3 * kHex, 4 * kHexNAc + 3 * kHex,
+        4 * kHexNAc + 4 * kHex, glycan_mass};
+    for(double y : ys)
+    {
+        if (generator() % 4 != 0)
+            peaks.push_back(model::spectrum::Peak(util::mass::SpectrumMass::ComputeMZ(
+                peptide_mass + y, 1 + generator() % 2), intensity(generator)));
+    }
+    util::mass::PeptideLadder ladder;
+    ladder.Set(peptide);
+    for(double mass : engine::search::SearchHelper::ComputeNonePTMPeptideMass(ladder, 2))
+    {
+        if (generator() % 3 != 0)
+            peaks.push_back(model::spectrum::Peak(
+                util::mass::SpectrumMass::ComputeMZ(mass, 1), intensity(generator)));
+    }
+}
+
+// chimeric spectra of glycans on three of the peptides, with noise peaks
+std::vector<model::spectrum::Spectrum> GlycopeptideSpectra(
+    const std::vector<std::string>& peptides, int size)
+{
+    const double kHexNAc = util::mass::GlycanMass::kHexNAc, kHex = util::mass::GlycanMass::kHex,
+        kFuc = util::mass::GlycanMass::kFuc;
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> intensity(1.0, 10000.0), noise(150.0, 3000.0);
+    std::vector<model::spectrum::Spectrum> spectra;
+    for(int scan = 1; scan <= size; scan++)
+    {
+        const std::string& peptide = peptides[scan % peptides.size()];
+        double glycan_mass = 4 * kHexNAc + 5 * kHex + (scan % 3 == 0 ? kFuc : 0);
+        std::vector<model::spectrum::Peak> peaks;
+        AddGlycopeptidePeaks(peptide, glycan_mass, generator, peaks);
+        for(int i = 1; i <= 2; i++)
+        {
+            AddGlycopeptidePeaks(peptides[(scan + i * 3) % peptides.size()],
+                glycan_mass + i * kHex, generator, peaks);
+        }
+        for(int i = 0; i < 40; i++)
+        {
+            peaks.push_back(model::spectrum::Peak(noise(generator), intensity(generator)));
+        }
+        std::sort(peaks.begin(), peaks.end(), [](const model::spectrum::Peak& a, const model::spectrum::Peak& b)
+            { return a.MZ() < b.MZ(); });
+
+        model::spectrum::Spectrum spectrum;
+        spectrum.set_scan(scan);
+        spectrum.set_parent_mz(util::mass::SpectrumMass::ComputeMZ(
+            util::mass::PeptideMass::Compute(peptide) + glycan_mass, 2));
+        spectrum.set_parent_charge(2);
+        spectrum.set_retention(scan);
+        spectrum.set_peaks(std::move(peaks));
+        spectra.push_back(std::move(spectrum));
+    }
+    return spectra;
+}
+
+std::vector<std::tuple<int, std::string, std::string, double, bool>> Matches(
+    const std::vector<engine::analysis::SearchResult>& results)
+{
+    std::vector<std::tuple<int, std::string, std::string, double, bool>> matches;
+    for(const auto& it : results)
+    {
+        matches.push_back(std::make_tuple(it.Scan(), it.Sequence(), it.Glycan(), it.Score(), it.Decoy()));
+    }
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+// the branch and bound reports the matches of the unbounded sweep, at any top k
+BOOST_AUTO_TEST_CASE( search_branch_bound_test )
+{
+    SearchParameter parameter;
+    parameter.n_thread = 2;
+    parameter.hexNAc_upper_bound = 6;
+    parameter.hex_upper_bound = 7;
+    parameter.fuc_upper_bound = 2;
+    parameter.neuAc_upper_bound = 2;
+    parameter.ms1_tol = 10;
+    parameter.ms1_by = model::spectrum::ToleranceBy::Dalton;
+    parameter.sweep = true;
+    engine::glycan::GlycanBuilder builder(parameter.hexNAc_upper_bound,
+        parameter.hex_upper_bound, parameter.fuc_upper_bound,
+            parameter.neuAc_upper_bound, parameter.neuGc_upper_bound);
+    builder.Build();
+
+    std::vector<std::string> peptides {"AANGTK", "LPNGTEK", "NASNKTAVR", "VVLHPNYSQVD",
+        "AVNKSTR", "EENGTIK", "QNLSAAR", "FIWNLTK"}, decoy_peptides {"KTGNAA", "KETGNPL"};
+    std::vector<model::spectrum::Spectrum> spectra = GlycopeptideSpectra(peptides, 24);
+    SearchParameter bounded_parameter = parameter;
+    bounded_parameter.branch_bound = true;
+    for(int top_k : {1, 3})
+    {
+        parameter.top_k = top_k;
+        bounded_parameter.top_k = top_k;
+        SearchDispatcher searcher(&builder, peptides, parameter);
+        searcher.set_decoy(decoy_peptides);
+        SearchDispatcher bounded(&builder, peptides, bounded_parameter);
+        bounded.set_decoy(decoy_peptides);
+
+        std::vector<engine::analysis::SearchResult> results = searcher.Dispatch(spectra);
+        std::vector<engine::analysis::SearchResult> bounded_results = bounded.Dispatch(spectra);
+        BOOST_CHECK(!results.empty());
+        BOOST_CHECK(Matches(bounded_results) == Matches(results));
+        BOOST_CHECK(bounded.Expanded() < searcher.Expanded());
+    }
+}
@@ -6,7 +6,17 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <cstdlib>
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
 
+#include "search_writer.h"
 #include "../util/io/fasta_reader.h"
 #include "../engine/protein/protein_digest.h"
 #include "../engine/protein/protein_ptm.h"
@@ -20,14 +30,24 @@ std::vector<engine::analysis::SearchResult>ConvertComposition(
 {
     std::vector<engine::analysis::SearchResult> res;
     std::unordered_set<std::string> seen;
+    std::unordered_map<std::string, std::string> names; // composition by glycan id
+    std::string key;
     for(const auto& it : results)
     {
-        std::string glycan = glycans_map.find(it.Glycan())->second->Name();
-        std::string key = std::to_string(it.Scan()) + "|" +  std::to_string(it.ModifySite()) + "|" +  
-            it.Sequence()+ "|" + glycan;
-        if (seen.find(key) == seen.end())
+        auto name = names.find(it.Glycan());
+        if (name == names.end())
+            name = names.emplace(it.Glycan(), glycans_map.find(it.Glycan())->second->Name()).first;
+        const std::string& glycan = name->second;
+        key.clear();
+        key += std::to_string(it.Scan());
+        key += '|';
+        key += std::to_string(it.ModifySite());
+        key += '|';
+        key += it.Sequence();
+        key += '|';
+        key += glycan;
+        if (seen.insert(key).second)
         {
-            seen.insert(key);
             engine::analysis::SearchResult r = it;
             r.set_glycan(glycan);
             res.push_back(r);
@@ -45,46 +65,132 @@ std::vector<model::protein::Protein> ReadProteins
     return proteins;
 }
 
-std::unordered_set<std::string> PeptidesDigestion
-    (const std::vector<model::protein::Protein> proteins, const SearchParameter& parameter)
+// peptides of the proteins, as views into the arena of the store returned.
+// The strings of the peptides are made only for the output.
+engine::protein::PeptideStore PeptidesDigestion
+    (const std::vector<model::protein::Protein>& proteins, const SearchParameter& parameter)
 {
     engine::protein::Digestion digest;
     digest.set_miss_cleavage(parameter.miss_cleavage);
-    std::unordered_set<std::string> peptides;
+    // peptides as views into the protein sequences until the modification
+    engine::protein::PeptideStore store;
 
-    // digestion
-    std::deque<engine::protein::Proteases> proteases(parameter.proteases);
-    engine::protein::Proteases enzyme = proteases.front();
-    digest.SetProtease(enzyme);
-    proteases.pop_front();
+    // digestion, of the peptides of the proteases before by the next in one pass
+    digest.SetProteases(parameter.proteases);
     for(const auto& protein : proteins)
     {
-        std::unordered_set<std::string> seqs = digest.Sequences(protein.Sequence(),
-            engine::protein::ProteinPTM::ContainsNGlycanSite);
-        peptides.insert(seqs.begin(), seqs.end());
+        size_t offset = store.Add(protein.Sequence());
+        digest.Digest(store, offset, (int) protein.Sequence().length(),
+            engine::protein::ProteinPTM::ContainsNGlycanSiteIn);
     }
-        
-    // double digestion or more
-    while (proteases.size() > 0)
+
+    // dynamic modification, the variants copied to the arena of the peptides
+    engine::protein::PeptideStore peptides;
+    engine::protein::Modifier::DynamicModification(
+        store, peptides, engine::protein::ProteinPTM::ContainsNGlycanSiteIn,
+        parameter.oxidation, parameter.deamidation, parameter.max_modifications);
+
+    return peptides;
+}
+
+// spectrum files of the path, the mgf files of a directory in order of name
+std::vector<std::string> ListSpectrumFiles(const std::string& path)
+{
+    std::vector<std::string> files;
+#ifndef _WIN32
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
     {
-        std::unordered_set<std::string> double_seqs;
-        enzyme = proteases.front();
-        digest.SetProtease(enzyme);
-        proteases.pop_front();
-        for(const auto& seq : peptides)
+        DIR* dir = opendir(path.c_str());
+        if (dir == nullptr)
+            return files;
+        while (struct dirent* entry = readdir(dir))
         {
-            std::unordered_set<std::string> seqs = digest.Sequences(seq,
-                engine::protein::ProteinPTM::ContainsNGlycanSite);
-            double_seqs.insert(seqs.begin(), seqs.end());
+            std::string name = entry->d_name;
+            if (name.size() > 4 && (name.substr(name.size() - 4) == ".mgf" || 
+                name.substr(name.size() - 4) == ".MGF"))
+                files.push_back(path + "/" + name);
         }
-        peptides.insert(double_seqs.begin(), double_seqs.end());
-    }   
-    // dynamic modification
-    peptides = engine::protein::Modifier::DynamicModification(
-        peptides, engine::protein::ProteinPTM::ContainsNGlycanSite,
-        parameter.oxidation, parameter.deamidation);
+        closedir(dir);
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+#endif
+    files.push_back(path);
+    return files;
+}
 
-    return peptides;
+// result path of a spectrum file in a batch, result.csv and a/b.mgf to result_b.csv
+std::string BatchOutputPath(const std::string& out_path, const std::string& spectra_path)
+{
+    std::string name = spectra_path.substr(spectra_path.find_last_of("/\\") + 1);
+    name = name.substr(0, name.find_last_of('.'));
+    size_t dot = out_path.find_last_of('.');
+    size_t slash = out_path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return out_path + "_" + name;
+    return out_path.substr(0, dot) + "_" + name + out_path.substr(dot);
+}
+
+// a whole number of at least 1, without trailing characters
+bool ParsePositive(const std::string& text, int& value)
+{
+    char* end = nullptr;
+    long number = strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || number < 1 || number > INT_MAX)
+        return false;
+    value = (int) number;
+    return true;
+}
+
+// a finite number above 0, without trailing characters
+bool ParsePositive(const std::string& text, double& value)
+{
+    char* end = nullptr;
+    double number = strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || !(number > 0) || !std::isfinite(number))
+        return false;
+    value = number;
+    return true;
+}
+
+// threads of the pipeline stages, "1:2:4:1" for precursor, sequence, glycan and analyze
+bool ParsePipeline(const std::string& text, std::vector<int>& threads)
+{
+    threads.clear();
+    std::stringstream ss(text);
+    std::string token;
+    while (std::getline(ss, token, ':'))
+    {
+        threads.push_back(atoi(token.c_str()));
+        if (threads.back() <= 0)
+            return false;
+    }
+    return threads.size() == 4;
+}
+
+// telemetry report next to the results, result.csv to result.json
+std::string TelemetryPath(const std::string& out_path)
+{
+    size_t dot = out_path.find_last_of('.');
+    size_t slash = out_path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return out_path + ".json";
+    return out_path.substr(0, dot) + ".json";
+}
+
+// split the matches of a fused search by the decoy flag
+void SplitDecoys(const std::vector<engine::analysis::SearchResult>& results,
+    std::vector<engine::analysis::SearchResult>& targets, 
+    std::vector<engine::analysis::SearchResult>& decoys)
+{
+    for(const auto& it : results)
+    {
+        if (it.Decoy())
+            decoys.push_back(it);
+        else
+            targets.push_back(it);
+    }
 }
 
 // report glycopeptide identification of spectrum
@@ -93,16 +199,18 @@ void ReportResults(const std::string& out_path,
 {
     std::ofstream outfile;
     outfile.open (out_path);
-    outfile << "scan,peptide,glycan,site,score\n";
-
-    for(auto it : results)
+    std::string buffer = "scan,peptide,glycan,site,score\n";
+    for(const auto& it : results)
     {
-        outfile << it.Scan() << ",";
-        outfile << engine::protein::Modifier::Interpret(it.Sequence()) << ",";
-        outfile << it.Glycan() << ",";
-        outfile << it.ModifySite() << ",";
-        outfile << it.Score() << "\n";
+        SearchWriter::Append(buffer, it, it.Glycan());
+        buffer += '\n';
+        if (buffer.size() >= (1 << 20))
+        {
+            outfile << buffer;
+            buffer.clear();
+        }
     }
+    outfile << buffer;
     outfile.close();
 }
 
@@ -2,6 +2,7 @@
 #define APP_SEARCH_PARAMETER_H_
 
 #include <deque>
+#include <vector>
 
 #include "../model/spectrum/spectrum.h"
 #include "../engine/protein/protein_digest.h"
@@ -25,6 +26,8 @@ struct SearchParameter
         model::spectrum::ToleranceBy::Dalton;
     // fdr
     double fdr_rate = 0.01;
+    // report the matches of the top k scores per spectrum
+    int top_k = 1;
     // protease
     std::deque<engine::protein::Proteases> proteases
     {
@@ -39,6 +42,36 @@ struct SearchParameter
     // dynamic modification
     bool oxidation = false;
     bool deamidation = false;
+    // modified sites per peptide, 0 for unlimited
+    int max_modifications = 0;
+    // precompute glycan containment matrix
+    bool subsumption = false;
+    // match Y ions by shifting the spectrum with peptide mass
+    bool shift_match = false;
+    // sweep the mass sorted glycan lattice in dp
+    bool sweep = false;
+    // one shared fragment ion index for peptide search
+    bool fragment_index = false;
+    // monotone bucket queue in dp
+    bool bucket_queue = false;
+    // bound the glycan dp, exact branch and bound of the lattice sweep,
+    // or heuristic beam width (0 disables)
+    bool branch_bound = false;
+    int beam_width = 0;
+    // oxonium ion triage
+    bool oxonium_filter = false;
+    double oxonium_relative_intensity = 0.05;
+    int oxonium_min_count = 2;
+    // per spectrum budget of the dp time, dp peak nodes and precursor candidates,
+    // 0 for unlimited. Spectra over budget are deferred, and searched at the end
+    // by all the threads if deferred_pass, otherwise left unmatched.
+    double budget_seconds = 0;
+    long budget_nodes = 0;
+    long budget_candidates = 0;
+    bool deferred_pass = false;
+    // threads of the precursor, sequence, glycan and analyze stages of a pipeline,
+    // empty runs all the stages of a spectrum on one thread of the pool
+    std::vector<int> pipeline;
 
 };
 
@@ -0,0 +1,209 @@
+#ifndef APP_SEARCH_SERVER_H_
+#define APP_SEARCH_SERVER_H_
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <unordered_map>
+
+#include "search_parameter.h"
+#include "search_dispatcher.h"
+#include "search_helper.h"
+#include "../util/io/local_socket.h"
+#include "../util/io/mgf_parser.h"
+#include "../engine/analysis/fdr_filter.h"
+
+// search jobs over a unix domain socket, one request line per job, with the
+// peptides, glycan library and indexes of the dispatcher kept in memory.
+//   FILE <path> [out=<csv>] [fdr=<rate>] [ms2_tol=<tol>] [top_k=<k>]
+//     -> OK <targets> <decoys> <reported> <csv>
+//   SPECTRUM <scan> <mz> <charge> <peaks> [ms2_tol=<tol>] [top_k=<k>], then a line
+//   of "<mz> <intensity>" per peak
+//     -> OK <n>, then n lines of scan,peptide,glycan,site,score,decoy
+//   SHUTDOWN -> OK
+// a failed job answers ERR <message>.
+class SearchServer
+{
+public:
+    SearchServer(SearchDispatcher& searcher, engine::glycan::GlycanBuilder* builder):
+        searcher_(searcher), builder_(builder), parameter_(searcher.Parameter()){}
+
+    // serve the clients in turn, until a shutdown request
+    bool Serve(const std::string& path)
+    {
+        util::io::LocalSocket server;
+        if (!server.Listen(path))
+            return false;
+        bool running = true;
+        while (running)
+        {
+            util::io::LocalSocket client;
+            if (!server.Accept(client))
+                continue;
+            std::string line;
+            while (running && client.ReadLine(line))
+            {
+                // a client gone before its reply is dropped
+                if (!Handle(client, line, running))
+                    break;
+            }
+        }
+        return true;
+    }
+
+protected:
+    // false if the reply cannot be written, running is cleared by a shutdown
+    bool Handle(util::io::LocalSocket& client, const std::string& line, bool& running)
+    {
+        std::vector<std::string> tokens;
+        std::istringstream stream(line);
+        std::string token;
+        while (stream >> token)
+        {
+            tokens.push_back(token);
+        }
+        if (tokens.empty())
+            return true;
+
+        if (tokens[0] == "SHUTDOWN")
+        {
+            running = false;
+            return client.Write("OK\n");
+        }
+        if (tokens[0] == "FILE" && tokens.size() >= 2)
+            return client.Write(FileJob(tokens));
+        if (tokens[0] == "SPECTRUM" && tokens.size() >= 5)
+            return client.Write(SpectrumJob(tokens, client));
+        return client.Write("ERR unknown request " + tokens[0] + "\n");
+    }
+
+    std::string FileJob(const std::vector<std::string>& tokens)
+    {
+        std::unordered_map<std::string, std::string> options = Options(tokens, 2);
+        std::string error;
+        double fdr = parameter_.fdr_rate;
+        if (!Apply(options, fdr, error))
+            return "ERR " + error + "\n";
+
+        const std::string& path = tokens[1];
+        std::string out_path = path.substr(0, path.find_last_of('.')) + ".csv";
+        if (options.find("out") != options.end())
+            out_path = options["out"];
+
+        std::ifstream file(path);
+        if (!file.is_open())
+            return "ERR cannot read " + path + "\n";
+        std::unique_ptr<util::io::SpectrumParser> parser = std::make_unique<util::io::MGFParser>();
+        util::io::SpectrumReader spectrum_reader(path, std::move(parser));
+        std::vector<model::spectrum::Spectrum> spectra = spectrum_reader.ReleaseSpectrum();
+
+        std::vector<engine::analysis::SearchResult> targets, decoys;
+        SplitDecoys(searcher_.Dispatch(spectra), targets, decoys);
+        engine::analysis::FDRFilter tester(fdr);
+        tester.set_data(targets, decoys);
+        tester.Init();
+        std::vector<engine::analysis::SearchResult> results =
+            ConvertComposition(tester.Filter(), builder_->GlycanMapsRef());
+        ReportResults(out_path, results);
+
+        std::ostringstream reply;
+        reply << "OK " << targets.size() << " " << decoys.size() << " "
+            << results.size() << " " << out_path << "\n";
+        return reply.str();
+    }
+
+    // unfiltered matches of one spectrum, as fdr needs a run
+    std::string SpectrumJob(const std::vector<std::string>& tokens, util::io::LocalSocket& client)
+    {
+        model::spectrum::Spectrum spectrum;
+        spectrum.set_scan(atoi(tokens[1].c_str()));
+        spectrum.set_retention(0);
+        spectrum.set_parent_mz(atof(tokens[2].c_str()));
+        spectrum.set_parent_charge(atoi(tokens[3].c_str()));
+        int size = atoi(tokens[4].c_str());
+        std::vector<model::spectrum::Peak> peaks;
+        std::string line;
+        for(int i = 0; i < size; i++)
+        {
+            if (!client.ReadLine(line))
+                return "ERR missing peaks\n";
+            std::istringstream stream(line);
+            double mz = 0, intensity = 0;
+            stream >> mz >> intensity;
+            peaks.push_back(model::spectrum::Peak(mz, intensity));
+        }
+        spectrum.set_peaks(std::move(peaks));
+
+        std::unordered_map<std::string, std::string> options = Options(tokens, 5);
+        std::string error;
+        double fdr = parameter_.fdr_rate;
+        if (!Apply(options, fdr, error))
+            return "ERR " + error + "\n";
+
+        std::vector<model::spectrum::Spectrum> spectra;
+        spectra.push_back(std::move(spectrum));
+        std::vector<engine::analysis::SearchResult> results =
+            ConvertComposition(searcher_.Dispatch(spectra), builder_->GlycanMapsRef());
+
+        std::ostringstream reply;
+        reply << "OK " << results.size() << "\n";
+        std::string rows;
+        for(const auto& it : results)
+        {
+            SearchWriter::Append(rows, it, it.Glycan());
+            rows += it.Decoy() ? ",1\n" : ",0\n";
+        }
+        return reply.str() + rows;
+    }
+
+    // key=value tokens from the index
+    static std::unordered_map<std::string, std::string> Options(
+        const std::vector<std::string>& tokens, int from)
+    {
+        std::unordered_map<std::string, std::string> options;
+        for(int i = from; i < (int) tokens.size(); i++)
+        {
+            size_t equal = tokens[i].find('=');
+            if (equal != std::string::npos)
+                options[tokens[i].substr(0, equal)] = tokens[i].substr(equal + 1);
+        }
+        return options;
+    }
+
+    // overrides of the job, the others are reset to the server defaults
+    bool Apply(const std::unordered_map<std::string, std::string>& options,
+        double& fdr, std::string& error)
+    {
+        double ms2_tol = parameter_.ms2_tol;
+        int top_k = parameter_.top_k;
+        for(const auto& it : options)
+        {
+            bool valid = true;
+            if (it.first == "fdr")
+                valid = ParsePositive(it.second, fdr) && fdr <= 1;
+            else if (it.first == "ms2_tol")
+                valid = ParsePositive(it.second, ms2_tol);
+            else if (it.first == "top_k")
+                valid = ParsePositive(it.second, top_k);
+            else if (it.first != "out")
+            {
+                error = "unknown option " + it.first;
+                return false;
+            }
+            if (!valid)
+            {
+                error = "invalid " + it.first + " " + it.second;
+                return false;
+            }
+        }
+        searcher_.set_ms2_tol(ms2_tol);
+        searcher_.set_top_k(top_k);
+        return true;
+    }
+
+    SearchDispatcher& searcher_;
+    engine::glycan::GlycanBuilder* builder_;
+    SearchParameter parameter_;
+};
+
+#endif
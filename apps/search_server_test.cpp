@@ -0,0 +1,258 @@
+#define BOOST_TEST_MODULE SearchServerTest
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <sstream>
+#include <fstream>
+#include <unistd.h>
+
+#include "search_server.h"
+#include "search_client.h"
+#include "../util/mass/peptide.h"
+#include "../util/mass/glycan.h"
+#include "../util/mass/spectrum.h"
+#include "../engine/search/search_helper.h"
+
+// a glycan of HexNAc(4)Hex(5) on the peptide, with oxonium, Y, b and y ions
+std::vector<double> GlycopeptidePeaks(const std::string& peptide, double& precursor_mz)
+{
+    const double kHexNAc = util::mass::GlycanMass::kHexNAc, kHex = util::mass::GlycanMass::kHex;
+    double peptide_mass = util::mass::PeptideMass::Compute(peptide);
+    std::vector<double> mzs {204.087, 138.055, 366.140, 274.092, 292.103, 186.076, 168.066};
+    std::vector<double> ys {kHexNAc, 2 * kHexNAc, 2 * kHexNAc + kHex, 2 * kHexNAc + 2 * kHex, 
+        2 * kHexNAc + 3 * kHex, 3 * kHexNAc + 3 * kHex, 4 * kHexNAc + 3 * kHex, 4 * kHexNAc + 4 * kHex};
+    for(double y : ys)
+    {
+        mzs.push_back(util::mass::SpectrumMass::ComputeMZ(peptide_mass + y, 1));
+        mzs.push_back(util::mass::SpectrumMass::ComputeMZ(peptide_mass + y, 2));
+    }
+    util::mass::PeptideLadder ladder;
+    ladder.Set(peptide);
+    for(double mass : engine::search::SearchHelper::ComputeNonePTMPeptideMass(ladder, 2))
+    {
+        mzs.push_back(util::mass::SpectrumMass::ComputeMZ(mass, 1));
+    }
+    precursor_mz = util::mass::SpectrumMass::ComputeMZ(peptide_mass + 4 * kHexNAc + 5 * kHex, 2);
+    return mzs;
+}
+
+// the lines printed by searching_client with the arguments
+int RunClient(const std::vector<std::string>& args, std::vector<std::string>& lines)
+{
+    std::vector<char*> argv;
+    for(const auto& arg : args)
+    {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    std::ostringstream out;
+    int code = SearchClient::Run((int) argv.size(), argv.data(), out);
+    lines.clear();
+    std::istringstream stream(out.str());
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        if (line.compare(0, 9, "time(ms):") != 0)
+            lines.push_back(line);
+    }
+    return code;
+}
+
+BOOST_AUTO_TEST_CASE( search_server_test ) 
+{
+    SearchParameter parameter;
+    parameter.n_thread = 2;
+    parameter.hexNAc_upper_bound = 5;
+    parameter.hex_upper_bound = 5;
+    parameter.fuc_upper_bound = 1;
+    parameter.neuAc_upper_bound = 1;
+    engine::glycan::GlycanBuilder builder(parameter.hexNAc_upper_bound, 
+        parameter.hex_upper_bound, parameter.fuc_upper_bound, 
+            parameter.neuAc_upper_bound, parameter.neuGc_upper_bound);
+    builder.Build();
+
+    std::string peptide = "AANGTK";
+    std::vector<std::string> peptides {peptide}, decoy_peptides {"KTGNAA"};
+    SearchDispatcher searcher(&builder, peptides, parameter);
+    searcher.set_decoy(decoy_peptides);
+
+    std::string path = "/tmp/search_server_test_" + std::to_string(getpid()) + ".sock";
+    SearchServer server(searcher, &builder);
+    std::thread serving([&server, &path] { server.Serve(path); });
+
+    util::io::LocalSocket client;
+    for(int i = 0; i < 100 && !client.Connect(path); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    double precursor_mz = 0;
+    std::vector<double> mzs = GlycopeptidePeaks(peptide, precursor_mz);
+    std::ostringstream request;
+    request.precision(10);
+    request << "SPECTRUM 7 " << precursor_mz << " 2 " << mzs.size() << " top_k=2\n";
+    for(double mz : mzs)
+    {
+        request << mz << " 1000\n";
+    }
+    BOOST_CHECK(client.Write(request.str()));
+    std::string line;
+    BOOST_CHECK(client.ReadLine(line));
+    BOOST_CHECK(line.compare(0, 3, "OK ") == 0);
+    int size = atoi(line.substr(3).c_str());
+    BOOST_CHECK(size > 0);
+    for(int i = 0; i < size; i++)
+    {
+        BOOST_CHECK(client.ReadLine(line));
+        BOOST_CHECK(line.compare(0, 2, "7,") == 0);
+    }
+
+    BOOST_CHECK(client.Write("FILE /nonexistent.mgf\n"));
+    BOOST_CHECK(client.ReadLine(line));
+    BOOST_CHECK(line.compare(0, 4, "ERR ") == 0);
+
+    BOOST_CHECK(client.Write("SPECTRUM 7 500 2 0 ms1_tol=5\n"));
+    BOOST_CHECK(client.ReadLine(line));
+    BOOST_CHECK(line == "ERR unknown option ms1_tol");
+
+    BOOST_CHECK(client.Write("SHUTDOWN\n"));
+    BOOST_CHECK(client.ReadLine(line));
+    BOOST_CHECK(line == "OK");
+    serving.join();
+    unlink(path.c_str());
+}
+
+// jobs from the command line of searching_client, to a server that survives
+// a client leaving before its reply and keeps the other files at its path
+BOOST_AUTO_TEST_CASE( search_client_test ) 
+{
+    SearchParameter parameter;
+    parameter.n_thread = 2;
+    parameter.hexNAc_upper_bound = 5;
+    parameter.hex_upper_bound = 5;
+    parameter.fuc_upper_bound = 1;
+    parameter.neuAc_upper_bound = 1;
+    engine::glycan::GlycanBuilder builder(parameter.hexNAc_upper_bound, 
+        parameter.hex_upper_bound, parameter.fuc_upper_bound, 
+            parameter.neuAc_upper_bound, parameter.neuGc_upper_bound);
+    builder.Build();
+
+    std::string peptide = "AANGTK";
+    std::vector<std::string> peptides {peptide}, decoy_peptides {"KTGNAA"};
+    SearchDispatcher searcher(&builder, peptides, parameter);
+    searcher.set_decoy(decoy_peptides);
+
+    std::string prefix = "/tmp/search_client_test_" + std::to_string(getpid());
+    std::string path = prefix + ".sock", mgf_path = prefix + ".mgf", csv_path = prefix + ".csv";
+    double precursor_mz = 0;
+    std::vector<double> mzs = GlycopeptidePeaks(peptide, precursor_mz);
+    std::ofstream mgf(mgf_path);
+    mgf.precision(10);
+    mgf << "BEGIN IONS\nTITLE=scan7\nPEPMASS=" << precursor_mz << "\nCHARGE=2+\n"
+        << "RTINSECONDS=1.00\nSCANS=7\n";
+    for(double mz : mzs)
+    {
+        mgf << mz << " 1000\n";
+    }
+    mgf << "END IONS\n";
+    mgf.close();
+
+    // a file that is not a socket is not replaced
+    SearchServer server(searcher, &builder);
+    std::ofstream(path) << "keep\n";
+    BOOST_CHECK(!server.Serve(path));
+    std::string kept;
+    std::ifstream(path) >> kept;
+    BOOST_CHECK(kept == "keep");
+    unlink(path.c_str());
+
+    std::thread serving([&server, &path] { server.Serve(path); });
+    std::vector<std::string> lines;
+    for(int i = 0; i < 100 && RunClient({"searching_client", path, "scan", mgf_path, "7"}, lines) != 0; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_REQUIRE(!lines.empty());
+    std::vector<std::string> matches = lines;
+    BOOST_CHECK(matches[0].compare(0, 3, "OK ") == 0);
+    BOOST_CHECK(atoi(matches[0].substr(3).c_str()) == (int) matches.size() - 1);
+    BOOST_CHECK(matches.size() > 1);
+    for(int i = 1; i < (int) matches.size(); i++)
+    {
+        BOOST_CHECK(matches[i].compare(0, 2, "7,") == 0);
+    }
+
+    // a client gone before its reply, the write fails instead of a signal
+    {
+        util::io::LocalSocket gone;
+        BOOST_CHECK(gone.Connect(path));
+        std::ostringstream request;
+        request.precision(10);
+        request << "SPECTRUM 7 " << precursor_mz << " 2 " << mzs.size() << "\n";
+        for(double mz : mzs)
+        {
+            request << mz << " 1000\n";
+        }
+        BOOST_CHECK(gone.Write(request.str()));
+    }
+
+    // the overrides of a job do not outlive it
+    BOOST_CHECK(RunClient({"searching_client", path, "scan", mgf_path, "7", "ms2_tol=0.5", "top_k=3"}, lines) == 0);
+    BOOST_CHECK(RunClient({"searching_client", path, "scan", mgf_path, "7"}, lines) == 0);
+    BOOST_CHECK(lines == matches);
+
+    BOOST_CHECK(RunClient({"searching_client", path, "file", mgf_path, "out=" + csv_path, "fdr=1"}, lines) == 0);
+    BOOST_REQUIRE(!lines.empty());
+    BOOST_CHECK(lines[0].compare(0, 3, "OK ") == 0);
+    BOOST_CHECK(lines[0].substr(lines[0].size() - csv_path.size()) == csv_path);
+    BOOST_CHECK(std::ifstream(csv_path).good());
+
+    BOOST_CHECK(RunClient({"searching_client", path, "scan", mgf_path, "7", "ms1_tol=5"}, lines) == 1);
+    BOOST_CHECK(lines.size() == 1 && lines[0] == "ERR unknown option ms1_tol");
+    BOOST_CHECK(RunClient({"searching_client", path, "scan", mgf_path, "8"}, lines) == 1);
+    for(std::string option : {"top_k=3abc", "top_k=0", "ms2_tol=0", "ms2_tol=x", "fdr=x", "fdr=0", "fdr=1.5"})
+    {
+        BOOST_CHECK(RunClient({"searching_client", path, "scan", mgf_path, "7", option}, lines) == 1);
+        BOOST_CHECK(lines.size() == 1 && lines[0].compare(0, 12, "ERR invalid ") == 0);
+    }
+
+    BOOST_CHECK(RunClient({"searching_client", path, "shutdown"}, lines) == 0);
+    BOOST_CHECK(lines.size() == 1 && lines[0] == "OK");
+    serving.join();
+    unlink(path.c_str());
+    unlink(mgf_path.c_str());
+    unlink(csv_path.c_str());
+}
+
+// the request of searching_client keeps the digits of the mgf
+BOOST_AUTO_TEST_CASE( search_client_precision_test ) 
+{
+    std::string prefix = "/tmp/search_client_precision_test_" + std::to_string(getpid());
+    std::string path = prefix + ".sock", mgf_path = prefix + ".mgf";
+    std::ofstream(mgf_path) << "BEGIN IONS\nTITLE=scan3\nPEPMASS=1234.5678912\nCHARGE=2+\n"
+        << "RTINSECONDS=1.00\nSCANS=3\n204.0867423 1000\nEND IONS\n";
+
+    // a server answering no match, after keeping the request
+    util::io::LocalSocket server;
+    BOOST_REQUIRE(server.Listen(path));
+    std::string header, peak;
+    std::thread serving([&server, &header, &peak]
+    {
+        util::io::LocalSocket client;
+        if (server.Accept(client) && client.ReadLine(header) && client.ReadLine(peak))
+            client.Write("OK 0\n");
+    });
+    std::vector<std::string> lines;
+    BOOST_CHECK(RunClient({"searching_client", path, "scan", mgf_path, "3"}, lines) == 0);
+    serving.join();
+
+    std::istringstream stream(header);
+    std::string request;
+    int scan = 0, charge = 0, size = 0;
+    double precursor_mz = 0, mz = 0;
+    stream >> request >> scan >> precursor_mz >> charge >> size;
+    BOOST_CHECK(request == "SPECTRUM" && scan == 3 && charge == 2 && size == 1);
+    BOOST_CHECK(std::fabs(precursor_mz - 1234.5678912) < 1e-6);
+    std::istringstream(peak) >> mz;
+    BOOST_CHECK(std::fabs(mz - 204.0867423) < 1e-6);
+    unlink(path.c_str());
+    unlink(mgf_path.c_str());
+}
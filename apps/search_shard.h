@@ -0,0 +1,180 @@
+#ifndef APP_SEARCH_SHARD_H_
+#define APP_SEARCH_SHARD_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <cstdlib>
+#include <utility>
+#include <sstream>
+
+#include "search_parameter.h"
+#include "../engine/analysis/search_result.h"
+
+// a shard searches a contiguous range of the spectra, ordered by scan, and
+// keeps the unfiltered target and decoy matches in a binary file. The shards
+// are merged to run the fdr over all the matches, as a single run does.
+class SearchShard
+{
+public:
+    static const uint32_t kVersion = 1;
+
+    // "i/N", the shard i of N, from 0
+    static bool Parse(const std::string& text, int& index, int& count)
+    {
+        size_t slash = text.find('/');
+        if (slash == std::string::npos)
+            return false;
+        return ParseWhole(text.substr(0, slash), index) && 
+            ParseWhole(text.substr(slash + 1), count) && index < count;
+    }
+
+    // spectra [first, second) of the shard
+    static std::pair<int, int> Range(int size, int index, int count)
+    {
+        return std::make_pair((int) ((long) size * index / count),
+            (int) ((long) size * (index + 1) / count));
+    }
+
+    // the key of the search database with the parameters of the search that
+    // change the unfiltered matches, the shards of one key are merged. The
+    // matching modes are in, as the shift match and the fragment index match
+    // within the exact tolerance, unlike the bucket search.
+    static uint64_t Key(uint64_t database_key, const SearchParameter& parameter)
+    {
+        std::stringstream ss;
+        ss << parameter.ms1_tol << " " << (int) parameter.ms1_by << " "
+            << parameter.ms2_tol << " " << (int) parameter.ms2_by << " "
+            << parameter.top_k << " " << parameter.oxonium_filter << " "
+            << parameter.oxonium_relative_intensity << " " << parameter.oxonium_min_count << " "
+            << parameter.branch_bound << " " << parameter.beam_width << " "
+            << parameter.budget_seconds << " " << parameter.budget_nodes << " "
+            << parameter.budget_candidates << " " << parameter.deferred_pass << " "
+            << parameter.shift_match << " " << parameter.fragment_index << " "
+            << parameter.sweep << " " << parameter.bucket_queue;
+        const std::string text = ss.str();
+        uint64_t hash = database_key;
+        for(char c : text)
+        {
+            hash ^= (unsigned char) c;
+            hash *= kPrime;
+        }
+        return hash;
+    }
+
+    // key identifies the sequences and parameters, as Key
+    static bool Write(const std::string& path, uint64_t key,
+        const std::vector<engine::analysis::SearchResult>& results)
+    {
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open())
+            return false;
+        out.write(Magic(), kMagicSize);
+        uint32_t version[2] = {kVersion, 0};
+        out.write(reinterpret_cast<const char*>(version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        uint64_t size = results.size();
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        for(const auto& it : results)
+        {
+            int32_t scan = it.Scan(), site = it.ModifySite();
+            double retention = it.Retention(), score = it.Score();
+            char decoy = it.Decoy() ? 1 : 0;
+            out.write(reinterpret_cast<const char*>(&scan), sizeof(scan));
+            out.write(reinterpret_cast<const char*>(&site), sizeof(site));
+            out.write(reinterpret_cast<const char*>(&retention), sizeof(retention));
+            out.write(reinterpret_cast<const char*>(&score), sizeof(score));
+            out.write(&decoy, sizeof(decoy));
+            WriteString(out, it.Sequence());
+            WriteString(out, it.Glycan());
+        }
+        return out.good();
+    }
+
+    // append the matches of the shard, false if unreadable or of another key
+    static bool Read(const std::string& path, uint64_t key,
+        std::vector<engine::analysis::SearchResult>& results)
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.seekg(0, std::ios::end);
+        uint64_t file_size = in.good() ? (uint64_t) in.tellg() : 0;
+        in.seekg(0, std::ios::beg);
+        char magic[kMagicSize];
+        uint32_t version[2] = {0, 0};
+        uint64_t stored = 0, size = 0;
+        in.read(magic, kMagicSize);
+        in.read(reinterpret_cast<char*>(version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&stored), sizeof(stored));
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (!in.good() || std::memcmp(magic, Magic(), kMagicSize) != 0 ||
+            version[0] != kVersion || stored != key)
+            return false;
+
+        for(uint64_t i = 0; i < size; i++)
+        {
+            int32_t scan = 0, site = 0;
+            double retention = 0, score = 0;
+            char decoy = 0;
+            in.read(reinterpret_cast<char*>(&scan), sizeof(scan));
+            in.read(reinterpret_cast<char*>(&site), sizeof(site));
+            in.read(reinterpret_cast<char*>(&retention), sizeof(retention));
+            in.read(reinterpret_cast<char*>(&score), sizeof(score));
+            in.read(&decoy, sizeof(decoy));
+            engine::analysis::SearchResult r;
+            r.set_scan(scan);
+            r.set_site(site);
+            r.set_retention(retention);
+            r.set_score(score);
+            r.set_decoy(decoy != 0);
+            std::string peptide, glycan;
+            if (!ReadString(in, file_size, peptide) || !ReadString(in, file_size, glycan))
+                return false;
+            r.set_peptide(peptide);
+            r.set_glycan(glycan);
+            results.push_back(r);
+        }
+        return true;
+    }
+
+protected:
+    // digits only, as ParsePositive, from 0
+    static bool ParseWhole(const std::string& text, int& value)
+    {
+        if (text.empty() || text[0] < '0' || text[0] > '9')
+            return false;
+        char* end = nullptr;
+        long number = strtol(text.c_str(), &end, 10);
+        if (*end != '\0' || number > INT_MAX)
+            return false;
+        value = (int) number;
+        return true;
+    }
+
+    static const char* Magic() { return "GLYCOPSM"; }
+    static const int kMagicSize = 8;
+    static const uint64_t kPrime = 1099511628211ULL;
+
+    static void WriteString(std::ofstream& out, const std::string& text)
+    {
+        uint32_t size = (uint32_t) text.size();
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(text.data(), size);
+    }
+
+    // false if the length is past the end of file
+    static bool ReadString(std::ifstream& in, uint64_t file_size, std::string& text)
+    {
+        uint32_t size = 0;
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (!in.good() || (uint64_t) in.tellg() + size > file_size)
+            return false;
+        text.assign(size, '\0');
+        in.read(&text[0], size);
+        return in.good();
+    }
+};
+
+#endif
@@ -0,0 +1,303 @@
+#ifndef APP_SEARCH_TELEMETRY_H_
+#define APP_SEARCH_TELEMETRY_H_
+
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <chrono>
+#include <condition_variable>
+
+// timers and candidate counts of the search stages. A worker keeps its own,
+// merged by the dispatcher after a run, so that counting takes no lock.
+class SearchTelemetry
+{
+public:
+    enum Stage { kParse, kOxonium, kPrecursor, kSequence, kGlycan, kAnalyze, kFilter, kFDR, kStages };
+    // histogram of candidates by power of two, 0, 1, 2-3, 4-7, ..., and the rest
+    static const int kBins = 16;
+
+    struct Counter
+    {
+        double seconds = 0;
+        long calls = 0;
+        long candidates = 0;
+        long histogram[kBins] = {0};
+    };
+
+    static const char* Name(Stage stage)
+    {
+        static const char* names[kStages] =
+            {"parse", "oxonium", "precursor", "sequence", "glycan", "analyze", "filter", "fdr"};
+        return names[stage];
+    }
+
+    // a call of the stage, with the candidates it passes on
+    void Add(Stage stage, double seconds, long candidates)
+    {
+        Counter& counter = counters_[stage];
+        counter.seconds += seconds;
+        counter.calls++;
+        counter.candidates += candidates;
+        counter.histogram[Bin(candidates)]++;
+    }
+
+    // seconds since start, then start is moved to now
+    void Add(Stage stage, std::chrono::steady_clock::time_point& start, long candidates)
+    {
+        auto stop = std::chrono::steady_clock::now();
+        Add(stage, std::chrono::duration<double>(stop - start).count(), candidates);
+        start = stop;
+    }
+
+    void add_spectra(long spectra) { spectra_ += spectra; }
+    // peak nodes created by the glycan dp of a spectrum
+    void add_expanded(int scan, long expanded)
+    {
+        expanded_ += expanded;
+        if (expanded <= 0)
+            return;
+        expanded_histogram_[Bin(expanded)]++;
+        Top(std::make_pair(expanded, scan));
+    }
+    // scan over the budget of a spectrum
+    void add_deferred(int scan) { deferred_.push_back(scan); }
+
+    void Merge(const SearchTelemetry& other)
+    {
+        for(int s = 0; s < kStages; s++)
+        {
+            Counter& counter = counters_[s];
+            const Counter& more = other.counters_[s];
+            counter.seconds += more.seconds;
+            counter.calls += more.calls;
+            counter.candidates += more.candidates;
+            for(int b = 0; b < kBins; b++)
+            {
+                counter.histogram[b] += more.histogram[b];
+            }
+        }
+        spectra_ += other.spectra_;
+        expanded_ += other.expanded_;
+        for(int b = 0; b < kBins; b++)
+        {
+            expanded_histogram_[b] += other.expanded_histogram_[b];
+        }
+        for(const auto& it : other.top_expanded_)
+        {
+            Top(it);
+        }
+        deferred_.insert(deferred_.end(), other.deferred_.begin(), other.deferred_.end());
+    }
+
+    void Reset() { *this = SearchTelemetry(); }
+
+    const Counter& Stat(Stage stage) const { return counters_[stage]; }
+    long Spectra() const { return spectra_; }
+    long Expanded() const { return expanded_; }
+    // spectra by the power of two of their peak nodes, as the stage candidates
+    const long* ExpandedHistogram() const { return expanded_histogram_; }
+    // peak nodes, scan of the spectra with the most nodes, the most first
+    std::vector<std::pair<long, int>> TopExpanded() const
+    {
+        std::vector<std::pair<long, int>> top = top_expanded_;
+        std::sort(top.begin(), top.end(), std::greater<std::pair<long, int>>());
+        return top;
+    }
+    long MaxExpanded() const
+    {
+        long most = 0;
+        for(const auto& it : top_expanded_)
+        {
+            most = std::max(most, it.first);
+        }
+        return most;
+    }
+    const std::vector<int>& Deferred() const { return deferred_; }
+
+    // json report, the stage seconds summed over the workers
+    bool Write(const std::string& path, double wall_seconds, int n_thread) const
+    {
+        std::ofstream out(path);
+        if (!out.is_open())
+            return false;
+        out << "{\n";
+        out << "  \"threads\": " << n_thread << ",\n";
+        out << "  \"wall_seconds\": " << wall_seconds << ",\n";
+        out << "  \"spectra\": " << spectra_ << ",\n";
+        out << "  \"spectra_per_second\": " << (wall_seconds > 0 ? spectra_ / wall_seconds : 0) << ",\n";
+        out << "  \"dp_nodes_expanded\": " << expanded_ << ",\n";
+        out << "  \"dp_nodes_max\": " << MaxExpanded() << ",\n";
+        out << "  \"dp_nodes_histogram\": [";
+        WriteHistogram(out, expanded_histogram_);
+        out << "],\n";
+        out << "  \"dp_nodes_top\": [";
+        std::vector<std::pair<long, int>> top = TopExpanded();
+        for(int i = 0; i < (int) top.size(); i++)
+        {
+            out << (i > 0 ? ", " : "") << "{\"scan\": " << top[i].second 
+                << ", \"nodes\": " << top[i].first << "}";
+        }
+        out << "],\n";
+        out << "  \"deferred\": [";
+        for(int i = 0; i < (int) deferred_.size(); i++)
+        {
+            out << (i > 0 ? ", " : "") << deferred_[i];
+        }
+        out << "],\n";
+        out << "  \"stages\": {\n";
+        for(int s = 0; s < kStages; s++)
+        {
+            const Counter& counter = counters_[s];
+            out << "    \"" << Name(static_cast<Stage>(s)) << "\": {\"seconds\": " << counter.seconds
+                << ", \"calls\": " << counter.calls << ", \"candidates\": " << counter.candidates
+                << ", \"histogram\": [";
+            WriteHistogram(out, counter.histogram);
+            out << "]}" << (s + 1 < kStages ? "," : "") << "\n";
+        }
+        out << "  }\n";
+        out << "}\n";
+        return out.good();
+    }
+
+protected:
+    static int Bin(long candidates)
+    {
+        int bin = 0;
+        while (candidates > 0 && bin < kBins - 1)
+        {
+            candidates >>= 1;
+            bin++;
+        }
+        return bin;
+    }
+
+    // the bins up to the last one counted
+    static void WriteHistogram(std::ostream& out, const long* histogram)
+    {
+        int last = kBins - 1;
+        while (last > 0 && histogram[last] == 0)
+            last--;
+        for(int b = 0; b <= last; b++)
+        {
+            out << (b > 0 ? ", " : "") << histogram[b];
+        }
+    }
+
+    // keeps the spectra of the most peak nodes
+    void Top(const std::pair<long, int>& spectrum)
+    {
+        std::greater<std::pair<long, int>> order;
+        if ((int) top_expanded_.size() < kTopExpanded)
+        {
+            top_expanded_.push_back(spectrum);
+            std::push_heap(top_expanded_.begin(), top_expanded_.end(), order);
+        }
+        else if (order(spectrum, top_expanded_.front()))
+        {
+            std::pop_heap(top_expanded_.begin(), top_expanded_.end(), order);
+            top_expanded_.back() = spectrum;
+            std::push_heap(top_expanded_.begin(), top_expanded_.end(), order);
+        }
+    }
+
+    // spectra of the most peak nodes kept for the report
+    static const int kTopExpanded = 16;
+
+    Counter counters_[kStages];
+    long spectra_ = 0;
+    long expanded_ = 0;
+    long expanded_histogram_[kBins] = {0};
+    std::vector<std::pair<long, int>> top_expanded_; // min heap of nodes, scan
+    std::vector<int> deferred_;
+};
+
+// a line of the spectra done on stderr every interval of seconds, during a run.
+// Each worker counts in its own cache line, read by the reporting thread.
+class SearchProgress
+{
+public:
+    SearchProgress(int total, int n_worker, double interval):
+        total_(total), n_worker_(n_worker), interval_(interval)
+    {
+        // operator new of c++14 aligns to 16 only, so the counts are placed
+        // on a cache line boundary of the storage
+        storage_.resize((n_worker_ + 1) * sizeof(Count));
+        void* first = storage_.data();
+        size_t space = storage_.size();
+        done_ = static_cast<Count*>(
+            std::align(alignof(Count), n_worker_ * sizeof(Count), first, space));
+        for(int w = 0; w < n_worker_; w++)
+        {
+            new (done_ + w) Count();
+        }
+        start_ = std::chrono::steady_clock::now();
+        if (interval_ > 0)
+            reporter_ = std::thread(&SearchProgress::Report, this);
+    }
+
+    SearchProgress(const SearchProgress&) = delete;
+    SearchProgress& operator=(const SearchProgress&) = delete;
+
+    ~SearchProgress()
+    {
+        if (!reporter_.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        stopped_.notify_all();
+        reporter_.join();
+    }
+
+    void Done(int w, int count)
+    {
+        done_[w].value.fetch_add(count, std::memory_order_relaxed);
+    }
+
+protected:
+    struct alignas(64) Count
+    {
+        std::atomic<int> value {0};
+    };
+
+    void Report()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto interval = std::chrono::duration<double>(interval_);
+        while (!stopped_.wait_for(lock, interval, [this] { return stop_; }))
+        {
+            long done = 0;
+            for(int w = 0; w < n_worker_; w++)
+            {
+                done += done_[w].value.load(std::memory_order_relaxed);
+            }
+            double seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start_).count();
+            std::cerr << "Searched " << done << "/" << total_ << " spectra, "
+                << (seconds > 0 ? done / seconds : 0) << " per second" << std::endl;
+        }
+    }
+
+    int total_;
+    int n_worker_;
+    std::vector<unsigned char> storage_;
+    Count* done_;
+    double interval_;
+    std::chrono::steady_clock::time_point start_;
+    std::thread reporter_;
+    std::mutex mutex_;
+    std::condition_variable stopped_;
+    bool stop_ = false;
+};
+
+#endif
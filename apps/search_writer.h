@@ -0,0 +1,150 @@
+#ifndef APP_SEARCH_WRITER_H_
+#define APP_SEARCH_WRITER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstdio>
+
+#include "../engine/analysis/search_result.h"
+#include "../engine/protein/modification.h"
+#include "../model/glycan/glycan.h"
+
+// writes the matches on a background thread as the workers push them, so the
+// unfiltered matches are on disk before the fdr. The rows are formatted into a
+// buffer without streams, and a push waits while kPending batches are queued.
+class SearchWriter
+{
+public:
+    // glycans by id, to write the names of compositions
+    SearchWriter(const std::unordered_map<std::string, std::unique_ptr<model::glycan::Glycan>>& glycans_map):
+        glycans_map_(glycans_map){}
+
+    SearchWriter(const SearchWriter&) = delete;
+    SearchWriter& operator=(const SearchWriter&) = delete;
+
+    ~SearchWriter() { Close(); }
+
+    bool Open(const std::string& path)
+    {
+        Close();
+        file_ = std::fopen(path.c_str(), "w");
+        if (file_ == nullptr)
+            return false;
+        std::fputs("scan,peptide,glycan,site,score,decoy\n", file_);
+        stop_ = false;
+        writer_ = std::thread(&SearchWriter::Run, this);
+        return true;
+    }
+
+    void Push(std::vector<engine::analysis::SearchResult> results)
+    {
+        if (results.empty() || file_ == nullptr)
+            return;
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [this] { return (int) pending_.size() < kPending; });
+        pending_.push_back(std::move(results));
+        ready_.notify_one();
+    }
+
+    // write the pending matches and close the file
+    void Close()
+    {
+        if (writer_.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            ready_.notify_one();
+            writer_.join();
+        }
+        if (file_ != nullptr)
+        {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    long Written() const { return written_; }
+
+    // a row of scan,peptide,glycan,site,score
+    static void Append(std::string& buffer, const engine::analysis::SearchResult& result, 
+        const std::string& glycan)
+    {
+        char number[32];
+        buffer += std::to_string(result.Scan());
+        buffer += ',';
+        engine::protein::Modifier::Interpret(result.Sequence(), buffer);
+        buffer += ',';
+        buffer += glycan;
+        buffer += ',';
+        buffer += std::to_string(result.ModifySite());
+        buffer += ',';
+        // as an ostream of the default precision
+        std::snprintf(number, sizeof(number), "%g", result.Score());
+        buffer += number;
+    }
+
+protected:
+    void Run()
+    {
+        std::string buffer;
+        std::vector<engine::analysis::SearchResult> results;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+                if (pending_.empty())
+                    break;
+                results = std::move(pending_.front());
+                pending_.pop_front();
+                space_.notify_one();
+            }
+            for(const auto& it : results)
+            {
+                Append(buffer, it, Name(it.Glycan()));
+                buffer += it.Decoy() ? ",1\n" : ",0\n";
+            }
+            written_ += (long) results.size();
+            if (buffer.size() >= kBuffer)
+            {
+                std::fwrite(buffer.data(), 1, buffer.size(), file_);
+                buffer.clear();
+            }
+        }
+        std::fwrite(buffer.data(), 1, buffer.size(), file_);
+    }
+
+    // name of the composition, computed once per glycan
+    const std::string& Name(const std::string& id)
+    {
+        auto it = names_.find(id);
+        if (it != names_.end())
+            return it->second;
+        auto glycan = glycans_map_.find(id);
+        return names_[id] = glycan == glycans_map_.end() ? id : glycan->second->Name();
+    }
+
+    static const int kPending = 64;
+    static const size_t kBuffer = 1 << 20;
+
+    const std::unordered_map<std::string, std::unique_ptr<model::glycan::Glycan>>& glycans_map_;
+    std::FILE* file_ = nullptr;
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    std::deque<std::vector<engine::analysis::SearchResult>> pending_;
+    bool stop_ = false;
+    long written_ = 0;
+    std::unordered_map<std::string, std::string> names_;
+};
+
+#endif
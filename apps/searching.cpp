@@ -10,7 +10,11 @@
 
 #include "search_parameter.h"
 #include "search_dispatcher.h"
+#include "search_database.h"
+#include "search_shard.h"
+#include "search_server.h"
 #include "search_helper.h"
+#include "search_telemetry.h"
 
 #include "../util/io/mgf_parser.h"
 #include "../util/io/fasta_reader.h"
@@ -27,11 +31,15 @@ const char *argp_program_version =
 const char *argp_program_bug_address =
   "<rz20@iu.edu>";
 
+static char args_doc[] = "[SHARD...]";
+
 static char doc[] =
   "GlycoCrushseq -- a program to search glycopeptide from high thoughput LS-MS/MS";
 
 static struct argp_option options[] = {
-    {"spath", 'i',    "spectrum.mgf",  0,  "mgf, Spectrum MS/MS Input Path" },
+    {"spath", 'i',    "spectrum.mgf",  0,  "mgf, Spectrum MS/MS Input Path, or a Directory of mgf, Repeatable" },
+    {"database", 'D',    "search.db",  0,  "Compiled Search Database, Built From Fasta If Not Matched" },
+    {"build_db", 'a',    0,  0,  "Build the Search Database at the Database Path, then Exit" },
     {"fpath", 'f',    "protein.fasta",  0,  "fasta, Protein Sequence Input Path" },
     {"dpath", 'd',    "reversed",  0,  "fasta, Protein Sequence for Decoy" },
     {"output",    'o',    "result.csv",   0,  "csv, Results Output Path" },
@@ -48,8 +56,31 @@ static struct argp_option options[] = {
     {"ms1_by",   'k',  "0",  0, "MS Tolereance By Int: PPM (0) or Dalton (1)" },
     {"ms2_by",   'l',  "1",  0, "MS2 Tolereance By Int: PPM (0) or Dalton (1)" },
     {"fdr_rate",   'r',  "0.01",  0, "FDR rate" },
+    {"combined_fdr",   'C',  0,  0, "One FDR Cutoff over All Spectrum Files" },
+    {"top_k",   'K',  "1",  0, "Report Matches of the Top K Scores per Spectrum" },
     {"glycan_type",   'g',  "C",  0, "The Searching Glycan Type, Complex (C), Hybrid (H), High Mannose(M)"},
     {"modification", 'c', "OD", 0, "The dynamic modification, including Oxidation(O) @ M and Deamidated(D) @ N, Q"},
+    {"max_mods",   'v',  "0",  0, "The Modified Sites per Peptide Upto, Unlimited (0)"},
+    {"subsumption",   'b',  0,  0, "Precompute the Glycan Containment Matrix"},
+    {"shift_match",   'Y',  0,  0, "Match Y Ions by Peptide Mass Shifted Spectrum"},
+    {"sweep",   'S',  0,  0, "Sweep the Mass Sorted Glycan Lattice Instead of Priority Queue"},
+    {"fragment_index",   'F',  0,  0, "Build One Shared Fragment Ion Index for Peptides"},
+    {"bucket_queue",   'Q',  0,  0, "Use the Monotone Bucket Queue Instead of Binary Heap in DP"},
+    {"branch_bound",   'B',  0,  0, "Stop Sweeping Peptides Unable to Reach the Top K Scores (Exact)"},
+    {"beam_width",   'W',  "0",  0, "Extend Top Glycans Per Peptide and Size, Unlimited (0)"},
+    {"oxonium",   'O',  "0",  0, "Skip Spectra Without Oxonium Ions Above Relative Intensity, Disabled (0)"},
+    {"oxonium_count",   'N',  "2",  0, "The Number of Oxonium Ions Required"},
+    {"shard",   'H',  "i/N",  0, "Search the i-th of N Scan Ranges, Write Unfiltered Matches to the Output"},
+    {"merge",   'M',  0,  0, "Merge the Shard Files Given as Arguments, then Filter by FDR"},
+    {"serve",   'L',  "search.sock",  0, "Keep the Search Space in Memory and Serve Jobs on the Unix Socket"},
+    {"telemetry",   'T',  0,  0, "Write Stage Timers and Candidate Counts as JSON Next to the Output"},
+    {"progress",   'P',  "0",  0, "Print Progress to Stderr Every Seconds, Disabled (0)"},
+    {"budget_seconds",   't',  "0",  0, "Defer Spectra of Glycan Search Longer Than Seconds, Unlimited (0)"},
+    {"budget_nodes",   'j',  "0",  0, "Defer Spectra of More Glycan Search Nodes, Unlimited (0)"},
+    {"budget_candidates",   'q',  "0",  0, "Defer Spectra of More Precursor Candidates, Unlimited (0)"},
+    {"deferred_pass",   'R',  0,  0, "Search the Deferred Spectra at the End with All Threads"},
+    {"pipeline",   'A',  "1:2:4:1",  0, "Run the Precursor, Sequence, Glycan and Analyze Stages on Their Own Threads"},
+    {"raw",   'E',  "raw.csv",  0, "Stream the Unfiltered Target and Decoy Matches to the File While Searching"},
     { 0 }
 };
 
@@ -57,15 +88,19 @@ static std::string default_spectra_path = "ZC_20171218_C22_R1.mgf";
 static std::string default_fasta_path = "haptoglobin.fasta";
 static std::string default_decoy_path = "titin.fasta";
 static std::string default_out_path = "result.csv";
+static std::string default_db_path = "";
 static std::string default_digestion = "TG";
 static std::string default_modification = "OD";
 static std::string default_glycan_type = "C";
 
 struct arguments
 {
-    char * spectra_path = const_cast<char*> (default_spectra_path.c_str());
+    std::vector<std::string> spectra_paths;
     char * fasta_path = const_cast<char*> (default_fasta_path.c_str());
     char * out_path = const_cast<char*> (default_out_path.c_str());
+    // compiled database
+    char * db_path = const_cast<char*> (default_db_path.c_str());
+    bool build_db = false;
     // decoy
     bool decoy_set = false;
     char * decoy_path = const_cast<char*> (default_decoy_path.c_str());
@@ -73,6 +108,7 @@ struct arguments
     int miss_cleavage = 2;
     char * digestion = const_cast<char*> (default_digestion.c_str());
     char * modification = const_cast<char*> (default_modification.c_str());
+    int max_modifications = 0;
     // upper bound of glycan seaerch
     int n_thread = 6;
     int hexNAc_upper_bound = 12;
@@ -87,8 +123,46 @@ struct arguments
     int ms2_by = 1;
     // fdr
     double fdr_rate = 0.01;
+    bool combined_fdr = false;
+    int top_k = 1;
     // glycan type
     char * glycan_type = const_cast<char*> (default_glycan_type.c_str());
+    // glycan containment matrix
+    bool subsumption = false;
+    // peptide mass shifted matching
+    bool shift_match = false;
+    // lattice sweep
+    bool sweep = false;
+    // fragment index
+    bool fragment_index = false;
+    // monotone queue
+    bool bucket_queue = false;
+    // bounded dp
+    bool branch_bound = false;
+    int beam_width = 0;
+    // oxonium ion triage
+    double oxonium_relative_intensity = 0;
+    int oxonium_min_count = 2;
+    // sharding
+    bool shard = false;
+    int shard_index = 0;
+    int shard_count = 1;
+    bool merge = false;
+    std::vector<std::string> shard_paths;
+    // search daemon
+    char * socket_path = nullptr;
+    // stage report and progress
+    bool telemetry = false;
+    double progress = 0;
+    // per spectrum budget
+    double budget_seconds = 0;
+    long budget_nodes = 0;
+    long budget_candidates = 0;
+    bool deferred_pass = false;
+    // threads of the pipeline stages
+    std::vector<int> pipeline;
+    // unfiltered matches
+    char * raw_path = nullptr;
 };
 
 
@@ -100,15 +174,107 @@ parse_opt (int key, char *arg, struct argp_state *state)
 
     switch (key)
     {
+    case 'a':
+        arguments->build_db = true;
+        break;
+
+    case 'b':
+        arguments->subsumption = true;
+        break;
+
+    case 'Y':
+        arguments->shift_match = true;
+        break;
+
+    case 'S':
+        arguments->sweep = true;
+        break;
+
+    case 'K':
+        if (!ParsePositive(arg, arguments->top_k))
+            argp_error(state, "top_k is a whole number of at least 1");
+        break;
+
+    case 'Q':
+        arguments->bucket_queue = true;
+        break;
+
+    case 'F':
+        arguments->fragment_index = true;
+        break;
+
+    case 'H':
+        arguments->shard = true;
+        if (!SearchShard::Parse(arg, arguments->shard_index, arguments->shard_count))
+            argp_error(state, "shard is i/N, with 0 <= i < N");
+        break;
+
+    case 'M':
+        arguments->merge = true;
+        break;
+
+    case 'L':
+        arguments->socket_path = arg;
+        break;
+
+    case 'T':
+        arguments->telemetry = true;
+        break;
+
+    case 'P':
+        arguments->progress = atof(arg);
+        break;
+
+    case 't':
+        arguments->budget_seconds = atof(arg);
+        break;
+
+    case 'j':
+        arguments->budget_nodes = atol(arg);
+        break;
+
+    case 'q':
+        arguments->budget_candidates = atol(arg);
+        break;
+
+    case 'R':
+        arguments->deferred_pass = true;
+        break;
+
+    case 'E':
+        arguments->raw_path = arg;
+        break;
+
+    case 'A':
+        if (!ParsePipeline(arg, arguments->pipeline))
+            argp_error(state, "pipeline is the threads of stages, e.g., 1:2:4:1");
+        break;
+
+    case 'B':
+        arguments->branch_bound = true;
+        break;
+
+    case 'W':
+        arguments->beam_width = atoi(arg);
+        break;
+
     case 'c':
         arguments->modification = arg;
         break;
 
+    case 'C':
+        arguments->combined_fdr = true;
+        break;
+
     case 'd':
         arguments->decoy_set = true;
         arguments->decoy_path = arg;
         break;
 
+    case 'D':
+        arguments->db_path = arg;
+        break;
+
     case 'e':
         arguments->digestion = arg;
         break;
@@ -122,7 +288,7 @@ parse_opt (int key, char *arg, struct argp_state *state)
         break;
 
     case 'i':
-        arguments->spectra_path = arg;
+        arguments->spectra_paths.push_back(arg);
         break;
 
     case 'k':
@@ -141,6 +307,14 @@ parse_opt (int key, char *arg, struct argp_state *state)
         arguments->ms2_tol = atof(arg);
         break;
 
+    case 'N':
+        arguments->oxonium_min_count = atoi(arg);
+        break;
+
+    case 'O':
+        arguments->oxonium_relative_intensity = atof(arg);
+        break;
+
     case 'o':
         arguments->out_path = arg;
         break;
@@ -157,6 +331,10 @@ parse_opt (int key, char *arg, struct argp_state *state)
         arguments->miss_cleavage = atoi(arg);
         break;
 
+    case 'v':
+        arguments->max_modifications = atoi(arg);
+        break;
+
     case 'u':
         arguments->neuAc_upper_bound = atoi(arg);
         break;
@@ -177,13 +355,17 @@ parse_opt (int key, char *arg, struct argp_state *state)
         arguments->fuc_upper_bound = atoi(arg);
         break;
 
+    case ARGP_KEY_ARG:
+        arguments->shard_paths.push_back(arg);
+        break;
+
     default:
         return ARGP_ERR_UNKNOWN;
     }
     return err;
 }
 
-static struct argp argp = { options, parse_opt, 0, doc };
+static struct argp argp = { options, parse_opt, args_doc, doc };
 
 
 SearchParameter GetParameter(const struct arguments& arguments)
@@ -191,6 +373,7 @@ SearchParameter GetParameter(const struct arguments& arguments)
     SearchParameter parameter;
     parameter.n_thread = arguments.n_thread;
     parameter.miss_cleavage = arguments.miss_cleavage;
+    parameter.max_modifications = arguments.max_modifications;
     parameter.hexNAc_upper_bound = arguments.hexNAc_upper_bound;
     parameter.hex_upper_bound = arguments.hex_upper_bound;
     parameter.neuAc_upper_bound = arguments.neuAc_upper_bound;
@@ -204,6 +387,22 @@ SearchParameter GetParameter(const struct arguments& arguments)
         model::spectrum::ToleranceBy::PPM :
         model::spectrum::ToleranceBy::Dalton;
     parameter.fdr_rate = arguments.fdr_rate;
+    parameter.top_k = arguments.top_k;
+    parameter.subsumption = arguments.subsumption;
+    parameter.shift_match = arguments.shift_match;
+    parameter.sweep = arguments.sweep;
+    parameter.bucket_queue = arguments.bucket_queue;
+    parameter.fragment_index = arguments.fragment_index;
+    parameter.branch_bound = arguments.branch_bound;
+    parameter.beam_width = arguments.beam_width;
+    parameter.oxonium_filter = arguments.oxonium_relative_intensity > 0;
+    parameter.oxonium_relative_intensity = arguments.oxonium_relative_intensity;
+    parameter.oxonium_min_count = arguments.oxonium_min_count;
+    parameter.budget_seconds = arguments.budget_seconds;
+    parameter.budget_nodes = arguments.budget_nodes;
+    parameter.budget_candidates = arguments.budget_candidates;
+    parameter.deferred_pass = arguments.deferred_pass;
+    parameter.pipeline = arguments.pipeline;
     std::string protease(arguments.digestion);
     for(const char& c : protease)
     {
@@ -276,50 +475,148 @@ int main(int argc, char *argv[])
     // parse arguments
     struct arguments arguments;
     argp_parse (&argp, argc, argv, 0, 0, &arguments);
-    std::string spectra_path(arguments.spectra_path) ;
+    std::vector<std::string> spectra_paths;
+    for(const auto& path : arguments.spectra_paths)
+    {
+        std::vector<std::string> files = ListSpectrumFiles(path);
+        spectra_paths.insert(spectra_paths.end(), files.begin(), files.end());
+    }
+    if (arguments.spectra_paths.empty())
+        spectra_paths.push_back(default_spectra_path);
     std::string fasta_path(arguments.fasta_path);
     std::string decoy_path(arguments.decoy_path); 
     std::string out_path(arguments.out_path);
     SearchParameter parameter = GetParameter(arguments);
 
-    // read spectrum
-    std::unique_ptr<util::io::SpectrumParser> parser = std::make_unique<util::io::MGFParser>();
-    util::io::SpectrumReader spectrum_reader(spectra_path, std::move(parser));
+    // read fasta and build peptides, or load the compiled database. The peptides
+    // are views into the stores, or into the mapped database
+    engine::protein::PeptideStore store, decoy_store;
+    engine::protein::PeptideViews peptides, decoy_peptides;
+    std::unique_ptr<engine::glycan::GlycanBuilder> builder;
+    std::string db_path(arguments.db_path);
+    if (arguments.build_db && db_path.empty())
+    {
+        std::cout << "Database path is required to build" << std::endl;
+        return 1;
+    }
+    uint64_t db_key = SearchDatabase::Key(fasta_path, arguments.decoy_set ? decoy_path : "", parameter);
+    uint64_t shard_key = SearchShard::Key(db_key, parameter);
 
-    // read fasta and build peptides
-    std::vector<std::string> peptides, decoy_peptides;
-    std::vector<model::protein::Protein> proteins = ReadProteins(fasta_path);
-    std::unordered_set<std::string> seqs = PeptidesDigestion(proteins, parameter);
-    peptides.insert(peptides.end(), seqs.begin(), seqs.end());
-    if (arguments.decoy_set)
+    // merge the shards, with the glycan library to name the compositions
+    if (arguments.merge)
     {
-        std::vector<model::protein::Protein> decoy_proteins = ReadProteins(decoy_path);
-        std::unordered_set<std::string> decoy_seqs = PeptidesDigestion(decoy_proteins, parameter);
-        decoy_peptides.insert(decoy_peptides.end(), decoy_seqs.begin(), decoy_seqs.end());
+        std::vector<engine::analysis::SearchResult> searched, targets, decoys;
+        for(const auto& path : arguments.shard_paths)
+        {
+            if (!SearchShard::Read(path, shard_key, searched))
+            {
+                std::cout << "Shard " << path << " not readable or searched with other parameters" << std::endl;
+                return 1;
+            }
+        }
+        SplitDecoys(searched, targets, decoys);
+        std::cout << "Total target:" << targets.size() <<" decoy:" << decoys.size() << std::endl;
+
+        builder = std::make_unique<engine::glycan::GlycanBuilder>(parameter.hexNAc_upper_bound, 
+                parameter.hex_upper_bound, parameter.fuc_upper_bound, 
+                    parameter.neuAc_upper_bound, parameter.neuGc_upper_bound,
+                        parameter.complex, parameter.hybrid, parameter.highmannose);
+        builder->Build();
+        engine::analysis::FDRFilter tester(parameter.fdr_rate);
+        tester.set_data(targets, decoys);
+        tester.Init();
+        ReportResults(out_path, ConvertComposition(tester.Filter(), builder->GlycanMapsRef()));
+        return 0;
+    }
+
+    SearchDatabase database;
+    bool loaded = !db_path.empty() && !arguments.build_db && database.Load(db_path, db_key);
+    if (loaded)
+    {
+        peptides = database.Target().peptides;
+        decoy_peptides = database.Decoy().peptides;
+        builder = database.Builder(parameter);
     }
     else
     {
-        // for(const auto& s : peptides)
-        // {
-        //     decoy_peptides.push_back(engine::protein::ReverseNGlycopeptide(s));
-        // }
-        for(auto& p: proteins)
+        if (!db_path.empty() && !arguments.build_db)
+            std::cout << "Database " << db_path << " not matched, build from fasta" << std::endl;
+
+        std::vector<model::protein::Protein> proteins = ReadProteins(fasta_path);
+        store = PeptidesDigestion(proteins, parameter);
+        if (arguments.decoy_set)
+        {
+            std::vector<model::protein::Protein> decoy_proteins = ReadProteins(decoy_path);
+            decoy_store = PeptidesDigestion(decoy_proteins, parameter);
+        }
+        else
+        {
+            // for(const auto& s : peptides)
+            // {
+            //     decoy_peptides.push_back(engine::protein::ReverseNGlycopeptide(s));
+            // }
+            for(auto& p: proteins)
+            {
+                std::string seq = p.Sequence();
+                std::reverse(seq.begin(), seq.end());
+                p.set_sequence(seq);
+            }
+            decoy_store = PeptidesDigestion(proteins, parameter);
+        }
+
+        // // build glycans
+        builder = std::make_unique<engine::glycan::GlycanBuilder>(parameter.hexNAc_upper_bound, 
+                parameter.hex_upper_bound, parameter.fuc_upper_bound, 
+                    parameter.neuAc_upper_bound, parameter.neuGc_upper_bound,
+                        parameter.complex, parameter.hybrid, parameter.highmannose);
+        builder->Build();
+        peptides = store.Views();
+        decoy_peptides = decoy_store.Views();
+    }
+
+    if (arguments.build_db)
+    {
+        if (!SearchDatabase::Write(db_path, db_key, peptides, decoy_peptides, *builder, parameter.n_thread))
         {
-            std::string seq = p.Sequence();
-            std::reverse(seq.begin(), seq.end());
-            p.set_sequence(seq);
+            std::cout << "Failed to write database " << db_path << std::endl;
+            return 1;
         }
-        std::unordered_set<std::string> decoy_seqs = PeptidesDigestion(proteins, parameter);
-        decoy_peptides.insert(decoy_peptides.end(), decoy_seqs.begin(), decoy_seqs.end());
+        std::cout << "Database written to " << db_path << std::endl;
+        return 0;
     }
 
-    // // build glycans
-    std::unique_ptr<engine::glycan::GlycanBuilder> builder =
-        std::make_unique<engine::glycan::GlycanBuilder>(parameter.hexNAc_upper_bound, 
-            parameter.hex_upper_bound, parameter.fuc_upper_bound, 
-                parameter.neuAc_upper_bound, parameter.neuGc_upper_bound,
-                    parameter.complex, parameter.hybrid, parameter.highmannose);
-    builder->Build();
+    if (arguments.shard && spectra_paths.size() != 1)
+    {
+        std::cout << "Shard searches one spectrum file" << std::endl;
+        return 1;
+    }
+    if (parameter.subsumption)
+        builder->BuildSubsumption();
+
+    // serve jobs with the search space built
+    if (arguments.socket_path != nullptr)
+    {
+        SearchDispatcher searcher(builder.get(), peptides, parameter);
+        if (loaded)
+        {
+            searcher.set_database(database.Target().masses, &database.Target().index);
+            searcher.set_decoy(decoy_peptides, database.Decoy().masses, &database.Decoy().index);
+        }
+        else
+        {
+            searcher.set_decoy(decoy_peptides);
+        }
+        // build the indexes before the first job
+        searcher.Dispatch(std::vector<model::spectrum::Spectrum>());
+        std::cout << "Serving on " << arguments.socket_path << std::endl;
+        SearchServer server(searcher, builder.get());
+        if (!server.Serve(arguments.socket_path))
+        {
+            std::cout << "Failed to listen on " << arguments.socket_path << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
     // search
     std::cout << "Start to scan\n"; 
@@ -332,31 +629,139 @@ int main(int argc, char *argv[])
 
     // std::cout << spectra.size() << std::endl;
 
-    // seraching targets 
-    SearchDispatcher target_searcher(spectrum_reader.GetSpectrum(), builder.get(), peptides, parameter);
-    std::vector<engine::analysis::SearchResult> targets = target_searcher.Dispatch();
+    // seraching targets and decoys in one pass, with the indexes and threads 
+    // shared by the spectrum files
+    SearchDispatcher searcher(builder.get(), peptides, parameter);
+    if (loaded)
+    {
+        searcher.set_database(database.Target().masses, &database.Target().index);
+        searcher.set_decoy(decoy_peptides, database.Decoy().masses, &database.Decoy().index);
+    }
+    else
+    {
+        searcher.set_decoy(decoy_peptides);
+    }
+    SearchWriter raw_writer(builder->GlycanMapsRef());
+    if (arguments.raw_path != nullptr)
+    {
+        if (!raw_writer.Open(arguments.raw_path))
+        {
+            std::cout << "Failed to write " << arguments.raw_path << std::endl;
+            return 1;
+        }
+        searcher.set_writer(&raw_writer);
+    }
+    searcher.set_progress(arguments.progress);
+    // parse and fdr, the stages of the dispatcher are merged at the end
+    SearchTelemetry telemetry;
+
+    std::vector<std::unique_ptr<engine::analysis::FDRFilter>> testers;
+    for(const auto& spectra_path : spectra_paths)
+    {
+        // read spectrum
+        auto stage_start = std::chrono::steady_clock::now();
+        std::unique_ptr<util::io::SpectrumParser> parser = std::make_unique<util::io::MGFParser>();
+        util::io::SpectrumReader spectrum_reader(spectra_path, std::move(parser));
+        std::vector<model::spectrum::Spectrum> spectra = spectrum_reader.ReleaseSpectrum();
+        telemetry.Add(SearchTelemetry::kParse, stage_start, (long) spectra.size());
+        if (arguments.shard)
+        {
+            std::pair<int, int> range = SearchShard::Range((int) spectra.size(), 
+                arguments.shard_index, arguments.shard_count);
+            spectra.erase(spectra.begin() + range.second, spectra.end());
+            spectra.erase(spectra.begin(), spectra.begin() + range.first);
+        }
 
-    // seraching decoys
-    SearchDispatcher decoy_searcher(spectrum_reader.GetSpectrum(), builder.get(), decoy_peptides, parameter);
-    std::vector<engine::analysis::SearchResult> decoys = decoy_searcher.Dispatch();
+        std::vector<engine::analysis::SearchResult> searched = searcher.Dispatch(spectra);
+        if (arguments.shard)
+        {
+            if (!SearchShard::Write(out_path, shard_key, searched))
+            {
+                std::cout << "Failed to write shard " << out_path << std::endl;
+                return 1;
+            }
+            std::cout << "Shard " << arguments.shard_index << "/" << arguments.shard_count 
+                << " of " << spectra.size() << " spectra written to " << out_path << std::endl;
+            return 0;
+        }
+        std::vector<engine::analysis::SearchResult> targets, decoys;
+        SplitDecoys(searched, targets, decoys);
+        if (spectra_paths.size() > 1)
+            std::cout << spectra_path << " ";
+        std::cout << "Total target:" << targets.size() <<" decoy:" << decoys.size() << std::endl;
+
+        // the best matches of each scan
+        testers.push_back(std::make_unique<engine::analysis::FDRFilter>(parameter.fdr_rate));
+        testers.back()->set_data(targets, decoys);
+    }
 
-    std::cout << "Total target:" << targets.size() <<" decoy:" << decoys.size() << std::endl;
+    if (parameter.oxonium_filter)
+    {
+        std::cout << "Oxonium filter skipped:" << searcher.Skipped() 
+            << " searched:" << searcher.Searched() 
+            << " saved worker time(s):" << searcher.SavedSeconds() << std::endl;
+    }
+    if (parameter.branch_bound || parameter.beam_width > 0)
+    {
+        long expanded = searcher.Expanded();
+        int searched = searcher.Searched();
+        std::cout << "Glycan nodes expanded:" << expanded << " per spectrum:" 
+            << (searched > 0 ? expanded / searched : 0) 
+            << " max:" << searcher.Telemetry().MaxExpanded() << std::endl;
+    }
 
-    // compute p value
-    engine::analysis::FDRFilter tester(parameter.fdr_rate);
-    tester.set_data(targets, decoys);
-    tester.Init();
-    std::vector<engine::analysis::SearchResult> results = tester.Filter();
-    // engine::analysis::MultiComparison tester(parameter.fdr_rate);
-    // std::vector<engine::analysis::SearchResult> results = tester.Tests(targets, decoys);
+    // the unfiltered matches are on disk before the fdr
+    raw_writer.Close();
 
+    if (parameter.budget_seconds > 0 || parameter.budget_nodes > 0 || parameter.budget_candidates > 0)
+    {
+        std::cout << "Over budget deferred:" << searcher.Telemetry().Deferred().size()
+            << (parameter.deferred_pass ? " searched at the end" : " unmatched") << std::endl;
+    }
 
-    // output analysis results
-    ReportResults(out_path, ConvertComposition(results, builder->GlycanMapsRef()));
-    // ReportResults(out_path, results);
+    // compute p value, by file or over all files
+    auto fdr_start = std::chrono::steady_clock::now();
+    engine::analysis::FDRFilter combined(parameter.fdr_rate);
+    for(auto& tester : testers)
+    {
+        if (arguments.combined_fdr)
+            combined.append_data(tester->Target(), tester->Decoy());
+        else
+            tester->Init();
+    }
+    if (arguments.combined_fdr)
+    {
+        combined.Init();
+        std::cout << "Combined FDR cutoff:" << combined.Cutoff() << std::endl;
+    }
+    for(int i = 0; i < (int) testers.size(); i++)
+    {
+        if (arguments.combined_fdr)
+            testers[i]->set_cutoff(combined.Cutoff());
+        std::vector<engine::analysis::SearchResult> results = testers[i]->Filter();
+        telemetry.Add(SearchTelemetry::kFDR, fdr_start, (long) results.size());
+        // engine::analysis::MultiComparison tester(parameter.fdr_rate);
+        // std::vector<engine::analysis::SearchResult> results = tester.Tests(targets, decoys);
+
+        // output analysis results
+        std::string path = spectra_paths.size() > 1 ? 
+            BatchOutputPath(out_path, spectra_paths[i]) : out_path;
+        ReportResults(path, ConvertComposition(results, builder->GlycanMapsRef()));
+        // ReportResults(out_path, results);
+        fdr_start = std::chrono::steady_clock::now();
+    }
 
     auto stop = std::chrono::high_resolution_clock::now(); 
     auto duration = std::chrono::duration_cast<std::chrono::seconds>(stop - start); 
     std::cout << "Total Time: " << duration.count() << std::endl; 
 
+    if (arguments.telemetry)
+    {
+        telemetry.Merge(searcher.Telemetry());
+        std::string telemetry_path = TelemetryPath(out_path);
+        if (!telemetry.Write(telemetry_path, 
+            std::chrono::duration<double>(stop - start).count(), parameter.n_thread))
+            std::cout << "Failed to write telemetry " << telemetry_path << std::endl;
+    }
+
 }
@@ -0,0 +1,8 @@
+#include <iostream>
+
+#include "search_client.h"
+
+int main(int argc, char *argv[])
+{
+    return SearchClient::Run(argc, argv, std::cout);
+}
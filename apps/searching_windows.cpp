@@ -9,7 +9,11 @@
 
 #include "search_parameter.h"
 #include "search_dispatcher.h"
+#include "search_database.h"
+#include "search_shard.h"
+#include "search_server.h"
 #include "search_helper.h"
+#include "search_telemetry.h"
 
 #include "../util/io/mgf_parser.h"
 #include "../util/io/fasta_reader.h"
@@ -26,22 +30,31 @@ int main(int argc, char *argv[])
     // parse arguments
     extern char *optarg;
     int opt;
-    std::string spectra_path = "/home/ruiz/Documents/Glycoseq-Cpp/data/ZC_20171218_C16_R1.mgf";
+    std::string default_spectra_path = "/home/ruiz/Documents/Glycoseq-Cpp/data/ZC_20171218_C16_R1.mgf";
+    std::vector<std::string> spectra_paths;
     std::string fasta_path = "/home/ruiz/Documents/GlycoCrushSeq/data/haptoglobin.fasta";
     std::string out_path = "result.csv";
     std::string decoy_path = "/home/ruiz/Documents/GlycoCrushSeq/data/titin.fasta";
     bool decoy_set = false;
+    std::string db_path = "";
+    bool build_db = false;
+    bool shard = false, merge = false, combined_fdr = false;
+    int shard_index = 0, shard_count = 1;
+    std::string socket_path = "";
+    bool write_telemetry = false;
+    std::string raw_path = "";
+    double progress_interval = 0;
     SearchParameter parameter;
     std::string protease = "TG";
     std::string glycan_type = "CHM";
 
     // pharser parameter
-    while ((opt = getopt(argc, argv, ":i:f:d:o:g:k:l:m:n:e:r:s:u:w:x:y:p:h")) != EOF)
+    while ((opt = getopt(argc, argv, ":i:f:d:D:o:g:k:l:m:n:e:r:s:u:v:w:x:y:p:O:N:W:K:H:L:P:t:j:q:A:E:abYSQFBMCTRh")) != EOF)
         switch(opt)
         {
             case 'i': 
-                spectra_path = optarg;
-                std::cout <<"The spectrum file located at " << spectra_path << std::endl; 
+                spectra_paths.push_back(optarg);
+                std::cout <<"The spectrum file located at " << optarg << std::endl; 
                 break;
             case 'f':
                 fasta_path = optarg;
@@ -52,6 +65,12 @@ int main(int argc, char *argv[])
                 decoy_path = optarg;
                 std::cout <<"The fasta decoy file the file at " << decoy_path << std::endl; 
                 break;
+            case 'D': 
+                db_path = optarg;
+                break;
+            case 'a': 
+                build_db = true;
+                break;
             case 'o': 
                 out_path = optarg;
                 std::cout <<"Output the file at " << out_path << std::endl; 
@@ -77,6 +96,83 @@ int main(int argc, char *argv[])
             case 'n':
                 parameter.ms2_tol = atof(optarg);
                 break;
+            case 'O':
+                parameter.oxonium_relative_intensity = atof(optarg);
+                parameter.oxonium_filter = parameter.oxonium_relative_intensity > 0;
+                break;
+            case 'N':
+                parameter.oxonium_min_count = atoi(optarg);
+                break;
+            case 'b':
+                parameter.subsumption = true;
+                break;
+            case 'Y':
+                parameter.shift_match = true;
+                break;
+            case 'S':
+                parameter.sweep = true;
+                break;
+            case 'K':
+                if (!ParsePositive(optarg, parameter.top_k))
+                {
+                    std::cout << "top_k is a whole number of at least 1" << std::endl;
+                    return 1;
+                }
+                break;
+            case 'Q':
+                parameter.bucket_queue = true;
+                break;
+            case 'F':
+                parameter.fragment_index = true;
+                break;
+            case 'H':
+                shard = true;
+                if (!SearchShard::Parse(optarg, shard_index, shard_count))
+                {
+                    std::cout << "shard is i/N, with 0 <= i < N" << std::endl;
+                    return 1;
+                }
+                break;
+            case 'M':
+                merge = true;
+                break;
+            case 'L':
+                socket_path = optarg;
+                break;
+            case 'T':
+                write_telemetry = true;
+                break;
+            case 't':
+                parameter.budget_seconds = atof(optarg);
+                break;
+            case 'j':
+                parameter.budget_nodes = atol(optarg);
+                break;
+            case 'q':
+                parameter.budget_candidates = atol(optarg);
+                break;
+            case 'R':
+                parameter.deferred_pass = true;
+                break;
+            case 'E':
+                raw_path = optarg;
+                break;
+            case 'A':
+                if (!ParsePipeline(optarg, parameter.pipeline))
+                {
+                    std::cout << "pipeline is the threads of stages, e.g., 1:2:4:1" << std::endl;
+                    return 1;
+                }
+                break;
+            case 'P':
+                progress_interval = atof(optarg);
+                break;
+            case 'B':
+                parameter.branch_bound = true;
+                break;
+            case 'W':
+                parameter.beam_width = atoi(optarg);
+                break;
 
             case 'e':
                 protease = optarg;
@@ -85,11 +181,18 @@ int main(int argc, char *argv[])
             case 'r':
                 parameter.fdr_rate = atof(optarg);
                 break;
+            case 'C':
+                combined_fdr = true;
+                break;
             
             case 's':
                 parameter.miss_cleavage = atoi(optarg);
                 break;
 
+            case 'v':
+                parameter.max_modifications = atoi(optarg);
+                break;
+
             case 'u':
                 parameter.neuAc_upper_bound = atoi(optarg);
                 break;
@@ -128,6 +231,9 @@ int main(int argc, char *argv[])
                 return 1;
         }
 
+    if (spectra_paths.empty())
+        spectra_paths.push_back(default_spectra_path);
+
     for(const char& c : protease)
     {
         switch (c)
@@ -173,40 +279,130 @@ int main(int argc, char *argv[])
         }
     }
 
-    // read spectrum
-    std::unique_ptr<util::io::SpectrumParser> parser = std::make_unique<util::io::MGFParser>();
-    util::io::SpectrumReader spectrum_reader(spectra_path, std::move(parser));
+    // read fasta and build peptides, or load the compiled database. The peptides
+    // are views into the stores, or into the mapped database
+    engine::protein::PeptideStore store, decoy_store;
+    engine::protein::PeptideViews peptides, decoy_peptides;
+    std::unique_ptr<engine::glycan::GlycanBuilder> builder;
+    if (build_db && db_path.empty())
+    {
+        std::cout << "Database path is required to build" << std::endl;
+        return 1;
+    }
+    uint64_t db_key = SearchDatabase::Key(fasta_path, decoy_set ? decoy_path : "", parameter);
+    uint64_t shard_key = SearchShard::Key(db_key, parameter);
+
+    // merge the shards given after the options
+    if (merge)
+    {
+        std::vector<engine::analysis::SearchResult> searched, targets, decoys;
+        for(int i = optind; i < argc; i++)
+        {
+            if (!SearchShard::Read(argv[i], shard_key, searched))
+            {
+                std::cout << "Shard " << argv[i] << " not readable or searched with other parameters" << std::endl;
+                return 1;
+            }
+        }
+        SplitDecoys(searched, targets, decoys);
+        std::cout << "Total target:" << targets.size() <<" decoy:" << decoys.size() << std::endl;
+
+        builder = std::make_unique<engine::glycan::GlycanBuilder>(parameter.hexNAc_upper_bound, 
+                parameter.hex_upper_bound, parameter.fuc_upper_bound, 
+                    parameter.neuAc_upper_bound, parameter.neuGc_upper_bound,
+                        parameter.complex, parameter.hybrid, parameter.highmannose);
+        builder->Build();
+        engine::analysis::FDRFilter tester(parameter.fdr_rate);
+        tester.set_data(targets, decoys);
+        tester.Init();
+        ReportResults(out_path, ConvertComposition(tester.Filter(), builder->GlycanMapsRef()));
+        return 0;
+    }
 
-    // read fasta and build peptides
-    std::vector<std::string> peptides, decoy_peptides;
-    std::vector<model::protein::Protein> proteins = ReadProteins(fasta_path);
-    std::unordered_set<std::string> seqs = PeptidesDigestion(proteins, parameter);
-    peptides.insert(peptides.end(), seqs.begin(), seqs.end());
-    if (decoy_set)
+    SearchDatabase database;
+    bool loaded = !db_path.empty() && !build_db && database.Load(db_path, db_key);
+    if (loaded)
     {
-        std::vector<model::protein::Protein> decoy_proteins = ReadProteins(decoy_path);
-        std::unordered_set<std::string> decoy_seqs = PeptidesDigestion(decoy_proteins, parameter);
-        decoy_peptides.insert(decoy_peptides.end(), decoy_seqs.begin(), decoy_seqs.end());
+        peptides = database.Target().peptides;
+        decoy_peptides = database.Decoy().peptides;
+        builder = database.Builder(parameter);
     }
     else
     {
-        for(auto& p: proteins)
+        if (!db_path.empty() && !build_db)
+            std::cout << "Database " << db_path << " not matched, build from fasta" << std::endl;
+
+        std::vector<model::protein::Protein> proteins = ReadProteins(fasta_path);
+        store = PeptidesDigestion(proteins, parameter);
+        if (decoy_set)
+        {
+            std::vector<model::protein::Protein> decoy_proteins = ReadProteins(decoy_path);
+            decoy_store = PeptidesDigestion(decoy_proteins, parameter);
+        }
+        else
+        {
+            for(auto& p: proteins)
+            {
+                std::string seq = p.Sequence();
+                std::reverse(seq.begin(), seq.end());
+                p.set_sequence(seq);
+            }
+            decoy_store = PeptidesDigestion(proteins, parameter);
+        }
+    
+        // // build glycans
+        builder = std::make_unique<engine::glycan::GlycanBuilder>(parameter.hexNAc_upper_bound, 
+                parameter.hex_upper_bound, parameter.fuc_upper_bound, 
+                    parameter.neuAc_upper_bound, parameter.neuGc_upper_bound,
+                        parameter.complex, parameter.hybrid, parameter.highmannose);
+        builder->Build();
+        peptides = store.Views();
+        decoy_peptides = decoy_store.Views();
+    }
+
+    if (build_db)
+    {
+        if (!SearchDatabase::Write(db_path, db_key, peptides, decoy_peptides, *builder, parameter.n_thread))
+        {
+            std::cout << "Failed to write database " << db_path << std::endl;
+            return 1;
+        }
+        std::cout << "Database written to " << db_path << std::endl;
+        return 0;
+    }
+
+    if (shard && spectra_paths.size() != 1)
+    {
+        std::cout << "Shard searches one spectrum file" << std::endl;
+        return 1;
+    }
+    if (parameter.subsumption)
+        builder->BuildSubsumption();
+
+    // serve jobs with the search space built
+    if (!socket_path.empty())
+    {
+        SearchDispatcher searcher(builder.get(), peptides, parameter);
+        if (loaded)
+        {
+            searcher.set_database(database.Target().masses, &database.Target().index);
+            searcher.set_decoy(decoy_peptides, database.Decoy().masses, &database.Decoy().index);
+        }
+        else
+        {
+            searcher.set_decoy(decoy_peptides);
+        }
+        // build the indexes before the first job
+        searcher.Dispatch(std::vector<model::spectrum::Spectrum>());
+        std::cout << "Serving on " << socket_path << std::endl;
+        SearchServer server(searcher, builder.get());
+        if (!server.Serve(socket_path))
         {
-            std::string seq = p.Sequence();
-            std::reverse(seq.begin(), seq.end());
-            p.set_sequence(seq);
+            std::cout << "Failed to listen on " << socket_path << std::endl;
+            return 1;
         }
-        std::unordered_set<std::string> decoy_seqs = PeptidesDigestion(proteins, parameter);
-        decoy_peptides.insert(decoy_peptides.end(), decoy_seqs.begin(), decoy_seqs.end());
-    }
-   
-    // // build glycans
-    std::unique_ptr<engine::glycan::GlycanBuilder> builder =
-        std::make_unique<engine::glycan::GlycanBuilder>(parameter.hexNAc_upper_bound, 
-            parameter.hex_upper_bound, parameter.fuc_upper_bound, 
-                parameter.neuAc_upper_bound, parameter.neuGc_upper_bound,
-                    parameter.complex, parameter.hybrid, parameter.highmannose);
-    builder->Build();
+        return 0;
+    }
 
     // search
     std::cout << "Start to scan\n"; 
@@ -219,31 +415,139 @@ int main(int argc, char *argv[])
 
     // std::cout << spectra.size() << std::endl;
 
-    // seraching targets 
-    SearchDispatcher target_searcher(spectrum_reader.GetSpectrum(), builder.get(), peptides, parameter);
-    std::vector<engine::analysis::SearchResult> targets = target_searcher.Dispatch();
+    // seraching targets and decoys in one pass, with the indexes and threads 
+    // shared by the spectrum files
+    SearchDispatcher searcher(builder.get(), peptides, parameter);
+    if (loaded)
+    {
+        searcher.set_database(database.Target().masses, &database.Target().index);
+        searcher.set_decoy(decoy_peptides, database.Decoy().masses, &database.Decoy().index);
+    }
+    else
+    {
+        searcher.set_decoy(decoy_peptides);
+    }
+    SearchWriter raw_writer(builder->GlycanMapsRef());
+    if (!raw_path.empty())
+    {
+        if (!raw_writer.Open(raw_path))
+        {
+            std::cout << "Failed to write " << raw_path << std::endl;
+            return 1;
+        }
+        searcher.set_writer(&raw_writer);
+    }
+    searcher.set_progress(progress_interval);
+    // parse and fdr, the stages of the dispatcher are merged at the end
+    SearchTelemetry telemetry;
+
+    std::vector<std::unique_ptr<engine::analysis::FDRFilter>> testers;
+    for(const auto& spectra_path : spectra_paths)
+    {
+        // read spectrum
+        auto stage_start = std::chrono::steady_clock::now();
+        std::unique_ptr<util::io::SpectrumParser> parser = std::make_unique<util::io::MGFParser>();
+        util::io::SpectrumReader spectrum_reader(spectra_path, std::move(parser));
+        std::vector<model::spectrum::Spectrum> spectra = spectrum_reader.ReleaseSpectrum();
+        telemetry.Add(SearchTelemetry::kParse, stage_start, (long) spectra.size());
+        if (shard)
+        {
+            std::pair<int, int> range = SearchShard::Range((int) spectra.size(), 
+                shard_index, shard_count);
+            spectra.erase(spectra.begin() + range.second, spectra.end());
+            spectra.erase(spectra.begin(), spectra.begin() + range.first);
+        }
 
-    // seraching decoys
-    SearchDispatcher decoy_searcher(spectrum_reader.GetSpectrum(), builder.get(), decoy_peptides, parameter);
-    std::vector<engine::analysis::SearchResult> decoys = decoy_searcher.Dispatch();
+        std::vector<engine::analysis::SearchResult> searched = searcher.Dispatch(spectra);
+        if (shard)
+        {
+            if (!SearchShard::Write(out_path, shard_key, searched))
+            {
+                std::cout << "Failed to write shard " << out_path << std::endl;
+                return 1;
+            }
+            std::cout << "Shard " << shard_index << "/" << shard_count 
+                << " of " << spectra.size() << " spectra written to " << out_path << std::endl;
+            return 0;
+        }
+        std::vector<engine::analysis::SearchResult> targets, decoys;
+        SplitDecoys(searched, targets, decoys);
+        if (spectra_paths.size() > 1)
+            std::cout << spectra_path << " ";
+        std::cout << "Total target:" << targets.size() <<" decoy:" << decoys.size() << std::endl;
+
+        // the best matches of each scan
+        testers.push_back(std::make_unique<engine::analysis::FDRFilter>(parameter.fdr_rate));
+        testers.back()->set_data(targets, decoys);
+    }
 
-    std::cout << "Total target:" << targets.size() <<" decoy:" << decoys.size() << std::endl;
+    if (parameter.oxonium_filter)
+    {
+        std::cout << "Oxonium filter skipped:" << searcher.Skipped() 
+            << " searched:" << searcher.Searched() 
+            << " saved worker time(s):" << searcher.SavedSeconds() << std::endl;
+    }
+    if (parameter.branch_bound || parameter.beam_width > 0)
+    {
+        long expanded = searcher.Expanded();
+        int searched = searcher.Searched();
+        std::cout << "Glycan nodes expanded:" << expanded << " per spectrum:" 
+            << (searched > 0 ? expanded / searched : 0) 
+            << " max:" << searcher.Telemetry().MaxExpanded() << std::endl;
+    }
 
-    // compute p value
-    engine::analysis::FDRFilter tester(parameter.fdr_rate);
-    tester.set_data(targets, decoys);
-    tester.Init();
-    std::vector<engine::analysis::SearchResult> results = tester.Filter();
-    // engine::analysis::MultiComparison tester(parameter.fdr_rate);
-    // std::vector<engine::analysis::SearchResult> results = tester.Tests(targets, decoys);
+    // the unfiltered matches are on disk before the fdr
+    raw_writer.Close();
 
+    if (parameter.budget_seconds > 0 || parameter.budget_nodes > 0 || parameter.budget_candidates > 0)
+    {
+        std::cout << "Over budget deferred:" << searcher.Telemetry().Deferred().size()
+            << (parameter.deferred_pass ? " searched at the end" : " unmatched") << std::endl;
+    }
 
-    // output analysis results
-    ReportResults(out_path, ConvertComposition(results, builder->GlycanMapsRef()));
-    // ReportResults(out_path, results);
+    // compute p value, by file or over all files
+    auto fdr_start = std::chrono::steady_clock::now();
+    engine::analysis::FDRFilter combined(parameter.fdr_rate);
+    for(auto& tester : testers)
+    {
+        if (combined_fdr)
+            combined.append_data(tester->Target(), tester->Decoy());
+        else
+            tester->Init();
+    }
+    if (combined_fdr)
+    {
+        combined.Init();
+        std::cout << "Combined FDR cutoff:" << combined.Cutoff() << std::endl;
+    }
+    for(int i = 0; i < (int) testers.size(); i++)
+    {
+        if (combined_fdr)
+            testers[i]->set_cutoff(combined.Cutoff());
+        std::vector<engine::analysis::SearchResult> results = testers[i]->Filter();
+        telemetry.Add(SearchTelemetry::kFDR, fdr_start, (long) results.size());
+        // engine::analysis::MultiComparison tester(parameter.fdr_rate);
+        // std::vector<engine::analysis::SearchResult> results = tester.Tests(targets, decoys);
+
+        // output analysis results
+        std::string path = spectra_paths.size() > 1 ? 
+            BatchOutputPath(out_path, spectra_paths[i]) : out_path;
+        ReportResults(path, ConvertComposition(results, builder->GlycanMapsRef()));
+        // ReportResults(out_path, results);
+        fdr_start = std::chrono::steady_clock::now();
+    }
 
     auto stop = std::chrono::high_resolution_clock::now(); 
     auto duration = std::chrono::duration_cast<std::chrono::seconds>(stop - start); 
     std::cout << "Total Time: " << duration.count() << std::endl; 
 
+    if (write_telemetry)
+    {
+        telemetry.Merge(searcher.Telemetry());
+        std::string telemetry_path = TelemetryPath(out_path);
+        if (!telemetry.Write(telemetry_path, 
+            std::chrono::duration<double>(stop - start).count(), parameter.n_thread))
+            std::cout << "Failed to write telemetry " << telemetry_path << std::endl;
+    }
+
 }
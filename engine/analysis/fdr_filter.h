@@ -146,6 +146,15 @@ public:
 
 
     
+    // matches already reduced to the best of each scan, e.g., by the 
+    // filters of other spectrum files, to share one cutoff
+    void append_data(const std::vector<SearchResult>& targets, 
+        const std::vector<SearchResult>& decoys)
+    {
+        target_.insert(target_.end(), targets.begin(), targets.end());
+        decoy_.insert(decoy_.end(), decoys.begin(), decoys.end());
+    }
+
     std::vector<SearchResult>& Target() { return target_; }
     std::vector<SearchResult>& Decoy() { return decoy_; }
     double Cutoff() const { return cutoff_; }
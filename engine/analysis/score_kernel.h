@@ -0,0 +1,68 @@
+#ifndef ENGINE_ANALYSIS_SCORE_KERNEL_H_
+#define ENGINE_ANALYSIS_SCORE_KERNEL_H_
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <unordered_set>
+#include "../../model/spectrum/peak.h"
+
+namespace engine{
+namespace analysis{
+
+// log intensity of the peaks computed once per spectrum, a set of peak
+// indexes is scored by walking its bitset in the order of peaks.
+class PeakScoreKernel
+{
+public:
+    PeakScoreKernel() = default;
+
+    void Init(const std::vector<model::spectrum::Peak>& peaks)
+    {
+        int size = (int) peaks.size();
+        log_.resize(size);
+        total_ = 0;
+        for(int i = 0; i < size; i++)
+        {
+            log_[i] = log(peaks[i].Intensity());
+            total_ += log_[i];
+        }
+        bits_.assign((size + 63) / 64, 0);
+    }
+
+    // sum of log intensity over all peaks
+    double Total() const { return total_; }
+    const std::vector<double>& LogIntensity() const { return log_; }
+
+    double Sum(const std::unordered_set<int>& peak_indexes)
+    {
+        for(int index : peak_indexes)
+        {
+            bits_[index >> 6] |= (uint64_t) 1 << (index & 63);
+        }
+
+        double sum = 0;
+        for(int w = 0; w < (int) bits_.size(); w++)
+        {
+            uint64_t word = bits_[w];
+            while (word != 0)
+            {
+                int index = (w << 6) + __builtin_ctzll(word);
+                sum += log_[index];
+                word &= word - 1;
+            }
+            bits_[w] = 0;
+        }
+        return sum;
+    }
+
+protected:
+    std::vector<double> log_;
+    std::vector<uint64_t> bits_;
+    double total_ = 0;
+};
+
+} // namespace analysis
+} // namespace engine
+
+#endif
@@ -5,6 +5,7 @@
 #include "../../model/spectrum/peak.h"
 #include "../../model/glycan/glycan.h"
 #include "search_result.h"
+#include "score_kernel.h"
 
 #include <string>
 #include <unordered_map>
@@ -13,6 +14,8 @@
 #include <memory>
 #include <algorithm>
 #include <climits>
+#include <functional>
+#include <cassert>
 
 #include "../../util/mass/glycan.h"
 #include "../../util/mass/peptide.h"
@@ -25,80 +28,96 @@ namespace analysis{
 class SearchAnalyzer
 {
 public:
-    SearchAnalyzer() = default;
+    SearchAnalyzer(int top_k=1): top_k_(top_k) { assert(top_k_ >= 1); }
 
+    int TopK() const { return top_k_; }
+    void set_top_k(int top_k) { assert(top_k >= 1); top_k_ = top_k; }
+
+    // keep the pairs of the top k scores, ties included
     std::vector<SearchResult> Analyze(
         int scan,
         const std::vector<model::spectrum::Peak>& peaks,
         const std::unordered_map<std::string, std::unordered_set<int>>& peptide_results,
         const std::unordered_map<std::string, std::unordered_set<int>>& glycan_results)
     {
-        std::vector<SearchResult> results;
-        // preprocess to extract peptide
-        std::unordered_map<std::string, std::vector<std::string>> peptides_map;
-        std::unordered_map<std::string, std::vector<std::string>> glycans_map;
+        Prepare(peaks);
+        return AnalyzePrepared(scan, peptide_results, glycan_results);
+    }
+
+    // log intensity of the peaks, shared by the analyses of a spectrum
+    void Prepare(const std::vector<model::spectrum::Peak>& peaks)
+    {
+        kernel_.Init(peaks);
+    }
+
+    // analyze against the peaks of the last Prepare
+    std::vector<SearchResult> AnalyzePrepared(
+        int scan,
+        const std::unordered_map<std::string, std::unordered_set<int>>& peptide_results,
+        const std::unordered_map<std::string, std::unordered_set<int>>& glycan_results)
+    {
+        // score each peak set once
+        std::vector<std::string> peptide_keys, glycan_keys;
+        std::vector<double> peptide_scores, glycan_scores;
+        std::unordered_map<std::string, std::vector<int>> peptides_map;
+        std::unordered_map<std::string, std::vector<int>> glycans_map;
         for (const auto& it : peptide_results)
         {
             std::string peptide = it.first.substr(0, it.first.find("|"));
-            
-            if (peptides_map.find(peptide) == peptides_map.end())
-            {
-                peptides_map[peptide] = std::vector<std::string>();
-            }
-            peptides_map[peptide].push_back(it.first);
+            peptides_map[peptide].push_back((int) peptide_keys.size());
+            peptide_keys.push_back(it.first);
+            peptide_scores.push_back(kernel_.Sum(it.second));
         }
         for (const auto& it : glycan_results)
         {    
             std::string peptide = it.first.substr(0, it.first.find("|"));
-            if (glycans_map.find(peptide) == glycans_map.end())
-            {
-                glycans_map[peptide] = std::vector<std::string>();
-            }
-            glycans_map[peptide].push_back(it.first);
+            glycans_map[peptide].push_back((int) glycan_keys.size());
+            glycan_keys.push_back(it.first);
+            glycan_scores.push_back(kernel_.Sum(it.second));
         }
         
         // analyze the best matches
-        double best_score = 0;
+        double sum = kernel_.Total();
+        std::vector<double> tiers; // top scores, descending
+        std::vector<std::pair<double, std::pair<int, int>>> kept;
         for(const auto& it : peptides_map)
         {
-            std::string peptide = it.first;
-
-            if (glycans_map.find(peptide) == glycans_map.end())
+            auto g_it = glycans_map.find(it.first);
+            if (g_it == glycans_map.end())
                 continue;
 
-            for(const auto& p : it.second)
+            for(int p : it.second)
             {              
-
-                for(const auto& g : glycans_map[peptide])
+                double peptide_score = peptide_scores[p];
+                for(int g : g_it->second)
                 {
-                    // get index
-                    std::unordered_set<int> peptides_index = peptide_results.find(p)->second;
-                    std::unordered_set<int> glycans_index = glycan_results.find(g)->second;
-                    // compute score
-                    double score = ComputePeakScore(peaks, peptides_index, glycans_index);
-                    
-                    // create results if higher score
-                    if (score > best_score)
-                    {
-                        best_score = score;
-                        results.clear();
-                    }
-                    if (score == best_score)
-                    {
-                        int pos = std::stoi(p.substr(peptide.length()+1));
-                        std::string glycan = g.substr(peptide.length()+1);
-                        SearchResult r;
-                        r.set_glycan(glycan);
-                        r.set_peptide(peptide);
-                        r.set_scan(scan);
-                        r.set_site(pos);
-                        r.set_score(score);
-                        results.push_back(r);
-                    }
+                    double score = sqrt(peptide_score * glycan_scores[g]) / sum;
+                    if (!(score >= 0))
+                        continue;
+                    if ((int) tiers.size() == top_k_ && score < tiers.back())
+                        continue;
+                    Rank(tiers, kept, score);
+                    kept.push_back(std::make_pair(score, std::make_pair(p, g)));
                 }
             }
         }
- 
+
+        std::vector<SearchResult> results;
+        for(const auto& it : kept)
+        {
+            const std::string& p = peptide_keys[it.second.first];
+            const std::string& g = glycan_keys[it.second.second];
+            std::string peptide = p.substr(0, p.find("|"));
+            int pos = std::stoi(p.substr(peptide.length()+1));
+            std::string glycan = g.substr(peptide.length()+1);
+            SearchResult r;
+            r.set_glycan(glycan);
+            r.set_peptide(peptide);
+            r.set_scan(scan);
+            r.set_site(pos);
+            r.set_score(it.first);
+            results.push_back(r);
+        }
         return results;
     }
 
@@ -159,6 +178,27 @@ public:
         return sqrt(peptide_score * glycan_score) / sum;
     }
 
+protected:
+    // insert the score into the tiers, drop the pairs below the last tier
+    void Rank(std::vector<double>& tiers, 
+        std::vector<std::pair<double, std::pair<int, int>>>& kept, double score) const
+    {
+        auto it = std::lower_bound(tiers.begin(), tiers.end(), score, std::greater<double>());
+        if (it != tiers.end() && *it == score)
+            return;
+        tiers.insert(it, score);
+        if ((int) tiers.size() <= top_k_)
+            return;
+
+        tiers.pop_back();
+        double lowest = tiers.back();
+        kept.erase(std::remove_if(kept.begin(), kept.end(), 
+            [lowest](const std::pair<double, std::pair<int, int>>& k) { return k.first < lowest; }), 
+            kept.end());
+    }
+
+    int top_k_;
+    PeakScoreKernel kernel_;
 };
 
 
@@ -0,0 +1,61 @@
+#define BOOST_TEST_MODULE AnalyzerTest
+#include <boost/test/unit_test.hpp>
+#include "search_analyzer.h"
+
+
+namespace engine{
+namespace analysis{
+
+BOOST_AUTO_TEST_CASE( score_kernel_test ) 
+{
+    std::vector<model::spectrum::Peak> peaks;
+    for(int i = 0; i < 130; i++)
+    {
+        peaks.push_back(model::spectrum::Peak(100.0 + i, 2.0 + i * 3.5));
+    }
+    PeakScoreKernel kernel;
+    kernel.Init(peaks);
+
+    std::unordered_set<int> index {0, 5, 63, 64, 65, 127, 129};
+    double expect = 0;
+    for(int i : index)
+    {
+        expect += log(peaks[i].Intensity());
+    }
+    BOOST_CHECK_CLOSE(kernel.Sum(index), expect, 1e-9);
+    // bitset is cleared after each sum
+    BOOST_CHECK_CLOSE(kernel.Sum(std::unordered_set<int>{1}), log(peaks[1].Intensity()), 1e-9);
+    BOOST_CHECK(kernel.Sum(std::unordered_set<int>()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE( search_analyzer_test ) 
+{
+    std::vector<model::spectrum::Peak> peaks;
+    for(int i = 0; i < 10; i++)
+    {
+        peaks.push_back(model::spectrum::Peak(200.0 + i, 10.0 + i));
+    }
+    std::unordered_map<std::string, std::unordered_set<int>> peptide_results {
+        {"PEPNIT|3", {0, 1, 2}}, {"PEPNIT|1", {0}}
+    };
+    std::unordered_map<std::string, std::unordered_set<int>> glycan_results {
+        {"PEPNIT|A", {5, 6}}, {"PEPNIT|B", {5, 6}}, {"PEPNIT|C", {7}}
+    };
+
+    SearchAnalyzer analyzer;
+    std::vector<SearchResult> results = analyzer.Analyze(1, peaks, peptide_results, glycan_results);
+    BOOST_CHECK(results.size() == 2); // tie of A and B
+    for(const auto& r : results)
+    {
+        BOOST_CHECK(r.ModifySite() == 3);
+        BOOST_CHECK_CLOSE(r.Score(), analyzer.ComputePeakScore(peaks, 
+            peptide_results["PEPNIT|3"], glycan_results["PEPNIT|A"]), 1e-9);
+    }
+
+    analyzer.set_top_k(2);
+    results = analyzer.Analyze(1, peaks, peptide_results, glycan_results);
+    BOOST_CHECK(results.size() == 3);
+}
+
+} // namespace analysis
+} // namespace engine
@@ -28,6 +28,7 @@ public:
     std::string Sequence() const { return peptide_; }
     std::string Glycan() const { return glycan_; }
     double Score() const { return score_; }
+    bool Decoy() const { return decoy_; }
 
     void set_scan(int scan) { scan_ = scan; }
     void set_retention(double retention) { retention_ = retention; }
@@ -35,14 +36,16 @@ public:
     void set_peptide(std::string seq) { peptide_ = seq; }
     void set_glycan(std::string glycan) { glycan_ = glycan; }
     void set_score(double score) { score_ = score; }
+    void set_decoy(bool decoy) { decoy_ = decoy; }
 
 protected:
     int scan_;
-    double retention_;
+    double retention_ = 0;
     std::string peptide_;
     std::string glycan_;
     int pos_;
     double score_;
+    bool decoy_ = false;
 };
 
 
@@ -55,6 +55,104 @@ BOOST_AUTO_TEST_CASE( glycan_builder_test )
     // BOOST_CHECK(glycans.size() > 10);
 }
 
+bool Satisify(const Glycan* identified_glycan, const Glycan* glycan)
+{
+    const std::vector<int>& identified_glycan_table = identified_glycan->TableConst();
+    const std::vector<int>& candidate_glycan_table = glycan->TableConst();
+    if (candidate_glycan_table.size() != identified_glycan_table.size())
+        return false;
+    for(int i = 0; i < (int) identified_glycan_table.size(); i++)
+    {
+        if (candidate_glycan_table[i] < identified_glycan_table[i])
+            return false;
+    }
+    if ((int) identified_glycan_table.size() == 24)
+    {
+        for(int i = 0; i < 4; i++)
+        {
+            if ((identified_glycan_table[12 + i] > 0 || identified_glycan_table[16 + i] > 0) 
+                && identified_glycan_table[4 + i] != candidate_glycan_table[4 + i])
+                return false;
+        }
+    }
+    else if ((int) identified_glycan_table.size() == 16)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            if ((identified_glycan_table[10 + i] > 0 || identified_glycan_table[12 + i] > 0)
+                && identified_glycan_table[6 + i] != candidate_glycan_table[6 + i])
+                return false;
+        }
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE( glycan_containment_test ) 
+{
+    GlycanBuilder builder(4, 5, 1, 2, 0, true, true, true);
+    builder.Build();
+    builder.BuildSubsumption();
+
+    const std::vector<Glycan*>& glycans = builder.GlycanListRef();
+    BOOST_CHECK(glycans.size() == builder.GlycanMapsRef().size());
+    BOOST_CHECK(builder.Subsumption()->Size() == (int) glycans.size());
+    
+    int contained = 0;
+    for(const auto& sub : glycans)
+    {
+        for(const auto& glycan : glycans)
+        {
+            bool expect = Satisify(sub, glycan);
+            BOOST_CHECK(GlycanContainment::Contains(glycan, sub) == expect);
+            BOOST_CHECK(builder.Subsumption()->Contains(glycan->Index(), sub->Index()) == expect);
+            if (expect) contained++;
+        }
+    }
+    BOOST_CHECK(contained > (int) glycans.size());
+
+    // sorted distinct masses for the shifted spectrum matching
+    const std::vector<double>& masses = builder.MassListRef();
+    BOOST_CHECK(masses.size() == builder.Glycans().size());
+    BOOST_CHECK(std::is_sorted(masses.begin(), masses.end()));
+    for(const auto& glycan : glycans)
+    {
+        BOOST_CHECK(std::binary_search(masses.begin(), masses.end(), glycan->Mass()));
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( glycan_dag_test ) 
+{
+    GlycanBuilder builder(4, 5, 1, 2, 0, true, true, true);
+    builder.Build();
+
+    const GlycanDAG& dag = builder.DAGRef();
+    const std::vector<Glycan*>& glycans = builder.GlycanListRef();
+    BOOST_CHECK(dag.Size() == (int) glycans.size());
+    BOOST_CHECK(std::is_sorted(dag.MassesRef().begin(), dag.MassesRef().end()));
+    BOOST_CHECK((int) dag.OffsetsRef().size() == dag.Size() + 1);
 
+    for(const auto& glycan : glycans)
+    {
+        int node = dag.Position(glycan->Index());
+        BOOST_CHECK(dag.GlycanOf(node) == glycan);
+        std::unordered_set<int> expect;
+        for(const auto& g : glycan->Children())
+        {
+            expect.insert(dag.Position(g->Index()));
+        }
+        std::unordered_set<int> children(dag.ChildBegin(node), dag.ChildEnd(node));
+        BOOST_CHECK(children == expect);
+        for(const auto& c : children)
+        {
+            // topological by mass
+            BOOST_CHECK(c > node);
+            BOOST_CHECK(dag.Mass(c) > dag.Mass(node));
+        }
+    }
+    BOOST_CHECK(dag.TypeOf(dag.Position(glycans.front()->Index())) == GlycanType::Complex);
+}
+
+
+}
 }
-}
\ No newline at end of file
@@ -3,12 +3,15 @@
 
 #include <deque>
 #include <memory>
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include "../../model/glycan/nglycan_complex.h"
 #include "../../model/glycan/nglycan_hybrid.h"
 #include "../../model/glycan/highmannose.h"
 #include "../../util/mass/glycan.h"
+#include "glycan_containment.h"
+#include "glycan_dag.h"
 
 namespace engine{
 namespace glycan {
@@ -36,6 +39,16 @@ public:
     std::unordered_map<std::string, std::unique_ptr<Glycan>>& GlycanMapsRef()
         { return glycans_map_; }
 
+    // sorted distinct glycan masses
+    const std::vector<double>& MassListRef() const { return mass_list_; }
+
+    // glycans by Glycan::Index
+    const std::vector<Glycan*>& GlycanListRef() const { return glycan_list_; }
+    // mass sorted lattice in arrays
+    const GlycanDAG& DAGRef() const { return dag_; }
+    // optional containment matrix, nullptr if not built
+    const SubsumptionMatrix* Subsumption() const { return subsumption_.get(); }
+
     std::vector<Monosaccharide> Candidates() { return candidates_; }
     int HexNAc() { return hexNAc_; }
     int Hex() { return hex_; }
@@ -63,6 +76,9 @@ public:
             double mass = util::mass::GlycanMass::Compute(node->Composition());
             std::string table_id = node->ID();
             node->set_mass(mass);
+            node->set_index((int) glycan_list_.size());
+            node->Pack();
+            glycan_list_.push_back(node);
             if (glycans_.find(mass) == glycans_.end())
             {
                 glycans_[mass] = std::vector<std::string>();
@@ -97,9 +113,52 @@ public:
             }
 
         }
+        BuildIndex();
+    }
+
+    // restore a library built before, glycans in order of Glycan::Index with
+    // mass, table and composition set, children in compressed sparse rows
+    void Restore(std::vector<std::unique_ptr<Glycan>>& glycans,
+        const std::vector<int>& child_offsets, const std::vector<int>& children)
+    {
+        for(auto& g : glycans)
+        {
+            Glycan* node = g.get();
+            std::string table_id = node->ID();
+            node->set_index((int) glycan_list_.size());
+            node->Pack();
+            glycan_list_.push_back(node);
+            glycans_[node->Mass()].push_back(table_id);
+            glycans_map_[table_id] = std::move(g);
+        }
+        for(int i = 0; i < (int) glycan_list_.size(); i++)
+        {
+            for(int j = child_offsets[i]; j < child_offsets[i + 1]; j++)
+            {
+                glycan_list_[i]->Add(glycan_list_[children[j]]);
+            }
+        }
+        BuildIndex();
+    }
+
+    void BuildSubsumption()
+    {
+        subsumption_ = std::make_unique<SubsumptionMatrix>();
+        subsumption_->Build(glycan_list_);
     }
 
 protected:
+    void BuildIndex()
+    {
+        mass_list_.clear();
+        for(const auto& it : glycans_)
+        {
+            mass_list_.push_back(it.first);
+        }
+        std::sort(mass_list_.begin(), mass_list_.end());
+        dag_.Build(glycan_list_);
+    }
+
     void InitQueue(std::deque<Glycan*>& queue)
     {
         std::string root_id = "";
@@ -172,6 +231,10 @@ protected:
     bool highmannose_;
     std::unordered_map<double, std::vector<std::string>> glycans_; // glycan mass, glycan id
     std::unordered_map<std::string, std::unique_ptr<Glycan>> glycans_map_; // glycan id -> glycan
+    std::vector<Glycan*> glycan_list_; // glycan index -> glycan
+    std::vector<double> mass_list_;
+    GlycanDAG dag_;
+    std::unique_ptr<SubsumptionMatrix> subsumption_;
     std::vector<Monosaccharide> candidates_;
 
 
@@ -0,0 +1,99 @@
+#ifndef ENGINE_GLYCAN_GLYCAN_CONTAINMENT_H_
+#define ENGINE_GLYCAN_GLYCAN_CONTAINMENT_H_
+
+#include <vector>
+#include <cstdint>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "../../model/glycan/glycan.h"
+
+namespace engine{
+namespace glycan {
+
+class GlycanContainment
+{
+public:
+    // whether the sub glycan is a substructure of the glycan, each lane of
+    // the sub is no more than the glycan, and the same at the terminal lanes.
+    // Requires Glycan::Pack on both glycans.
+    static bool Contains(const model::glycan::Glycan* glycan,
+        const model::glycan::Glycan* sub)
+    {
+        const uint8_t* a = sub->Packed().data();
+        const uint8_t* b = glycan->Packed().data();
+        const uint8_t* t = sub->Terminal().data();
+#if defined(__AVX2__)
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+        __m256i vt = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(t));
+        __m256i le = _mm256_cmpeq_epi8(_mm256_max_epu8(va, vb), vb);
+        __m256i eq = _mm256_cmpeq_epi8(va, vb);
+        __m256i ok = _mm256_or_si256(_mm256_and_si256(vt, eq), _mm256_andnot_si256(vt, le));
+        return _mm256_movemask_epi8(ok) == -1;
+#elif defined(__SSE2__)
+        __m128i ok = _mm_and_si128(Lanes(a, b, t), Lanes(a + 16, b + 16, t + 16));
+        return _mm_movemask_epi8(ok) == 0xFFFF;
+#else
+        for(int i = 0; i < model::glycan::Glycan::kLanes; i++)
+        {
+            if (a[i] > b[i] || (t[i] && a[i] != b[i]))
+                return false;
+        }
+        return true;
+#endif
+    }
+
+protected:
+#if !defined(__AVX2__) && defined(__SSE2__)
+    static __m128i Lanes(const uint8_t* a, const uint8_t* b, const uint8_t* t)
+    {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        __m128i vt = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t));
+        __m128i le = _mm_cmpeq_epi8(_mm_max_epu8(va, vb), vb);
+        __m128i eq = _mm_cmpeq_epi8(va, vb);
+        return _mm_or_si128(_mm_and_si128(vt, eq), _mm_andnot_si128(vt, le));
+    }
+#endif
+};
+
+// bit-matrix of the containment over the glycan library by Glycan::Index,
+// row of the sub glycan, column of the glycan contains it.
+class SubsumptionMatrix
+{
+public:
+    SubsumptionMatrix() = default;
+
+    void Build(const std::vector<model::glycan::Glycan*>& glycans)
+    {
+        size_ = (int) glycans.size();
+        words_ = (size_ + 63) / 64;
+        bits_.assign((size_t) size_ * words_, 0);
+        for(int i = 0; i < size_; i++)
+        {
+            uint64_t* row = bits_.data() + (size_t) i * words_;
+            for(int j = 0; j < size_; j++)
+            {
+                if (GlycanContainment::Contains(glycans[j], glycans[i]))
+                    row[j >> 6] |= (uint64_t) 1 << (j & 63);
+            }
+        }
+    }
+
+    int Size() const { return size_; }
+    bool Contains(int glycan, int sub) const
+    {
+        return (bits_[(size_t) sub * words_ + (glycan >> 6)] >> (glycan & 63)) & 1;
+    }
+
+protected:
+    int size_ = 0;
+    int words_ = 0;
+    std::vector<uint64_t> bits_;
+};
+
+} // namespace glycan
+} // namespace engine
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef ENGINE_GLYCAN_GLYCAN_DAG_H_
+#define ENGINE_GLYCAN_GLYCAN_DAG_H_
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "../../model/glycan/glycan.h"
+
+namespace engine{
+namespace glycan {
+
+enum class GlycanType : uint8_t
+{
+    Complex, Hybrid, HighMannose
+};
+
+// read-only glycan lattice in compressed sparse rows, nodes are sorted by mass,
+// since a child is always heavier than its parent, the order is topological.
+class GlycanDAG
+{
+public:
+    GlycanDAG() = default;
+
+    void Build(const std::vector<model::glycan::Glycan*>& glycans)
+    {
+        int size = (int) glycans.size();
+        std::vector<int> order(size);
+        for(int i = 0; i < size; i++)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&glycans](int a, int b)
+            { return glycans[a]->Mass() < glycans[b]->Mass(); });
+
+        position_.assign(size, -1);
+        for(int i = 0; i < size; i++)
+        {
+            position_[order[i]] = i;
+        }
+
+        glycans_.clear();
+        masses_.clear();
+        types_.clear();
+        offsets_.assign(1, 0);
+        children_.clear();
+        for(const auto& index : order)
+        {
+            model::glycan::Glycan* glycan = glycans[index];
+            glycans_.push_back(glycan);
+            masses_.push_back(glycan->Mass());
+            types_.push_back(Type(glycan));
+
+            std::vector<int> children;
+            for(const auto& g : glycan->Children())
+            {
+                children.push_back(position_[g->Index()]);
+            }
+            std::sort(children.begin(), children.end());
+            children.erase(std::unique(children.begin(), children.end()), children.end());
+            children_.insert(children_.end(), children.begin(), children.end());
+            offsets_.push_back((int) children_.size());
+        }
+    }
+
+    int Size() const { return (int) masses_.size(); }
+    // node position of Glycan::Index
+    int Position(int index) const { return position_[index]; }
+    double Mass(int node) const { return masses_[node]; }
+    GlycanType TypeOf(int node) const { return types_[node]; }
+    model::glycan::Glycan* GlycanOf(int node) const { return glycans_[node]; }
+    const int* ChildBegin(int node) const { return children_.data() + offsets_[node]; }
+    const int* ChildEnd(int node) const { return children_.data() + offsets_[node + 1]; }
+
+    const std::vector<double>& MassesRef() const { return masses_; }
+    const std::vector<int>& OffsetsRef() const { return offsets_; }
+    const std::vector<int>& ChildrenRef() const { return children_; }
+    const std::vector<GlycanType>& TypesRef() const { return types_; }
+
+protected:
+    static GlycanType Type(const model::glycan::Glycan* glycan)
+    {
+        int size = (int) glycan->TableConst().size();
+        if (size == 16)
+            return GlycanType::Hybrid;
+        if (size == 6)
+            return GlycanType::HighMannose;
+        return GlycanType::Complex;
+    }
+
+    std::vector<double> masses_;
+    std::vector<int> offsets_;
+    std::vector<int> children_;
+    std::vector<GlycanType> types_;
+    std::vector<model::glycan::Glycan*> glycans_;
+    std::vector<int> position_; // glycan index -> node
+};
+
+} // namespace glycan
+} // namespace engine
+
+#endif
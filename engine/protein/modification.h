@@ -3,8 +3,10 @@
 
 #include <vector>
 #include <string>
-#include <regex>
+#include <cstdint>
+#include <functional>
 #include <unordered_set>
+#include "peptide_store.h"
 
 namespace engine {
 namespace protein {
@@ -12,28 +14,50 @@ namespace protein {
 class Modifier
 {
 public:
+    static const int kMaxSites = 63;
+
+    // oxidation of M, then deamidation of N or of Q, of at most max_modifications
+    // sites per peptide (0 for unlimited). The variants of a peptide are masks
+    // over its sites, each written into one reused string for the filter; the
+    // kept variants are sequences, as the precursor and fragment lookups key
+    // the candidates by sequence.
     static std::unordered_set<std::string> DynamicModification(
         std::unordered_set<std::string>& peptides, 
         std::function<bool(const std::string&)> filter,
-        bool oxidation=true, bool deamidation=true)
+        bool oxidation=true, bool deamidation=true, int max_modifications=0)
     {
         std::unordered_set<std::string> peptides_modified;
-
-        if (oxidation)
-            peptides = Oxidation(peptides);
-        if (deamidation)
-            peptides = Deamidation(peptides);
-
+        Sites sites;
         for(const auto& it: peptides)
         {
-            if(filter(it))
+            Variants(it.data(), it.length(), oxidation, deamidation, max_modifications, sites,
+                [&](const std::string& variant)
             {
-                peptides_modified.insert(it);
-            }
+                if (filter(variant))
+                    peptides_modified.insert(variant);
+            });
         }
         return peptides_modified;
     }
 
+    // as above, of the peptides of a store, the variants kept by the filter
+    // copied to the arena of the other store
+    static void DynamicModification(const PeptideStore& peptides, PeptideStore& modified,
+        std::function<bool(const char*, size_t)> filter,
+        bool oxidation=true, bool deamidation=true, int max_modifications=0)
+    {
+        Sites sites;
+        for(int i = 0; i < peptides.Size(); i++)
+        {
+            Variants(peptides.Data(i), peptides.ViewOf(i).length, oxidation, deamidation, 
+                max_modifications, sites, [&](const std::string& variant)
+            {
+                if (filter(variant.data(), variant.length()))
+                    modified.Insert(variant.data(), variant.length());
+            });
+        }
+    }
+
     static std::unordered_set<std::string> Oxidation(const std::unordered_set<std::string>& peptides)
     {
         std::unordered_set<std::string> peptides_modified;
@@ -72,71 +96,164 @@ public:
 
     static std::string Interpret(const std::string& sequence) {
 
-        std::string s = sequence;
-        std::regex m ("\\$");
-        std::regex n ("@");
-        std::regex q ("#");
-        s = std::regex_replace (s,m,"M*");
-        s = std::regex_replace (s,n,"N^");
-        s = std::regex_replace (s,q,"Q^");
+        std::string s;
+        Interpret(sequence, s);
         return s;
     }
 
+    // append the sequence with $ as M*, @ as N^ and # as Q^
+    static void Interpret(const std::string& sequence, std::string& out)
+    {
+        out.reserve(out.size() + sequence.size() + 4);
+        for(char c : sequence)
+        {
+            switch (c)
+            {
+            case '$':
+                out += "M*";
+                break;
+            case '@':
+                out += "N^";
+                break;
+            case '#':
+                out += "Q^";
+                break;
+            default:
+                out += c;
+                break;
+            }
+        }
+    }
+
     static std::unordered_set<std::string> Modification(const std::string& sequence, 
         const char& origin, const char& replace)
     {
         std::unordered_set<std::string> modified;
-        std::vector<int> index = FindChar(sequence, origin);
-        std::vector<std::vector<int>> permutes = Combinatation(index);
-        for(const auto& vec : permutes)
+        std::vector<int> index;
+        FindChar(sequence, origin, index);
+        Combination((int) index.size(), 0, [&](uint64_t mask, int)
         {
-            modified.insert(ReplaceString(sequence, vec, replace));
-        }
+            modified.insert(ReplaceString(sequence, index, mask, replace));
+        });
         return modified;
     }
 
-    static std::vector<std::vector<int>> Combinatation(const std::vector<int>& sequence)
+    // the masks over size sites of at most limit bits (0 for unlimited), by the
+    // number of bits. A mask holds upto kMaxSites sites, the sites of a peptide
+    // with more are left unmodified.
+    static void Combination(int size, int limit, 
+        const std::function<void(uint64_t, int)>& visit)
     {
-        std::vector<std::vector<int>> results;
-        std::vector<int> temp;
-        RecurCombination(sequence, 0, temp, results);
-        return results;
+        if (size > kMaxSites)
+        {
+            visit(0, 0);
+            return;
+        }
+        if (limit <= 0 || limit > size)
+            limit = size;
+        for(int k = 0; k <= limit; k++)
+        {
+            uint64_t mask = (k == 0) ? 0 : (((uint64_t) 1 << k) - 1);
+            uint64_t end = (uint64_t) 1 << size;
+            while (mask < end)
+            {
+                visit(mask, k);
+                if (mask == 0)
+                    break;
+                // the next mask of k bits
+                uint64_t low = mask & (~mask + 1);
+                uint64_t ripple = mask + low;
+                mask = ripple | (((mask ^ ripple) >> 2) / low);
+            }
+        }
     }
 
 protected:
-    static std::string ReplaceString(const std::string& sequence, const std::vector<int>& index, const char& replace)
+    static std::string ReplaceString(const std::string& sequence, 
+        const std::vector<int>& index, uint64_t mask, const char& replace)
     {
         std::string str = sequence;
-        for(const auto& i : index)
+        for(int i = 0; i < (int) index.size(); i++)
         {
-            str[i] = replace;
+            if (mask & ((uint64_t) 1 << i))
+                str[index[i]] = replace;
         }
         return str;
     }
 
-    static std::vector<int> FindChar(const std::string& seq, const char& c)
+    // sites of a peptide and its variant, reused for the next peptide
+    struct Sites
+    {
+        std::vector<int> none, oxidized, asparagine, glutamine;
+        std::string variant;
+    };
+
+    // the variants of a peptide, each in the string of the sites
+    static void Variants(const char* sequence, size_t length, 
+        bool oxidation, bool deamidation, int max_modifications, Sites& sites,
+        const std::function<void(const std::string&)>& keep)
     {
-        std::vector<int> results;
-        for(int i = 0; i < (int)seq.size(); i++)
+        const std::vector<int>& none = sites.none;
+        std::string& variant = sites.variant;
+        const std::vector<int>& m = oxidation ? FindChar(sequence, length, 'M', sites.oxidized) : none;
+        const std::vector<int>& n = deamidation ? FindChar(sequence, length, 'N', sites.asparagine) : none;
+        const std::vector<int>& q = deamidation ? FindChar(sequence, length, 'Q', sites.glutamine) : none;
+        Combination((int) m.size(), max_modifications, [&](uint64_t mask_m, int count)
         {
-            if (seq[i] == c)
-                results.push_back(i);
-        }
-        return results;
+            int left = max_modifications > 0 ? max_modifications - count : 0;
+            if (max_modifications > 0 && left == 0)
+            {
+                keep(Variant(sequence, length, m, mask_m, '$', none, 0, '@', variant));
+                return;
+            }
+            Combination((int) n.size(), left, [&](uint64_t mask_n, int)
+            {
+                keep(Variant(sequence, length, m, mask_m, '$', n, mask_n, '@', variant));
+            });
+            Combination((int) q.size(), left, [&](uint64_t mask_q, int)
+            {
+                if (mask_q != 0)
+                    keep(Variant(sequence, length, m, mask_m, '$', q, mask_q, '#', variant));
+            });
+        });
     }
 
-    static void RecurCombination(const std::vector<int>& sequence, int idx, std::vector<int>& temp, std::vector<std::vector<int>>& ans)
+    // the variant of the masks of two kinds of sites
+    static const std::string& Variant(const char* sequence, size_t length, 
+        const std::vector<int>& first, uint64_t first_mask, char first_replace,
+        const std::vector<int>& second, uint64_t second_mask, char second_replace,
+        std::string& variant)
     {
-        if (idx == (int) sequence.size())
+        variant.assign(sequence, length);
+        for(int i = 0; i < (int) first.size(); i++)
         {
-            ans.push_back(temp);
-            return;
+            if (first_mask & ((uint64_t) 1 << i))
+                variant[first[i]] = first_replace;
         }
-        temp.push_back(sequence[idx]);
-        RecurCombination(sequence, idx + 1, temp, ans);
-        temp.pop_back();
-        RecurCombination(sequence, idx + 1, temp, ans);
+        for(int i = 0; i < (int) second.size(); i++)
+        {
+            if (second_mask & ((uint64_t) 1 << i))
+                variant[second[i]] = second_replace;
+        }
+        return variant;
+    }
+
+    static const std::vector<int>& FindChar(const std::string& seq, const char& c, 
+        std::vector<int>& results)
+    {
+        return FindChar(seq.data(), seq.length(), c, results);
+    }
 
+    static const std::vector<int>& FindChar(const char* seq, size_t length, const char& c, 
+        std::vector<int>& results)
+    {
+        results.clear();
+        for(int i = 0; i < (int) length; i++)
+        {
+            if (seq[i] == c)
+                results.push_back(i);
+        }
+        return results;
     }
 
 };
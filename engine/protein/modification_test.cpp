@@ -81,4 +81,4 @@ BOOST_AUTO_TEST_CASE( digest_test )
     }
 
     
-}
\ No newline at end of file
+}
@@ -0,0 +1,242 @@
+#ifndef ENGINE_PROTEIN_PEPTIDE_STORE_H_
+#define ENGINE_PROTEIN_PEPTIDE_STORE_H_
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_set>
+
+namespace engine {
+namespace protein {
+
+// residues [offset, offset + length) of an arena
+struct PeptideView
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+// peptides as views into an arena that outlives the list, e.g., the arena of a
+// PeptideStore or the residues of the mapped search database
+class PeptideViews
+{
+public:
+    PeptideViews() = default;
+    PeptideViews(const char* arena, const PeptideView* views, int size):
+        arena_(arena), views_(views), size_(size){}
+
+    int Size() const { return size_; }
+    const char* Arena() const { return arena_; }
+    const PeptideView* Views() const { return views_; }
+    const char* Data(int index) const { return arena_ + views_[index].offset; }
+    int Length(int index) const { return (int) views_[index].length; }
+
+    std::string Peptide(int index) const
+    {
+        return std::string(Data(index), views_[index].length);
+    }
+
+    // as std::string::compare of the peptide to the residues
+    int Compare(int index, const char* residues, size_t length) const
+    {
+        size_t size = views_[index].length;
+        int order = std::memcmp(Data(index), residues, std::min(size, length));
+        if (order != 0)
+            return order;
+        return size < length ? -1 : (size > length ? 1 : 0);
+    }
+
+    // index of the peptide in a list in order of residues, -1 if not in
+    int Find(const char* residues, size_t length) const
+    {
+        int first = 0, last = size_;
+        while (first < last)
+        {
+            int middle = first + (last - first) / 2;
+            if (Compare(middle, residues, length) < 0)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        if (first < size_ && Compare(first, residues, length) == 0)
+            return first;
+        return -1;
+    }
+
+    // strictly in order of residues, so distinct
+    bool Sorted() const
+    {
+        for(int i = 1; i < size_; i++)
+        {
+            if (Compare(i - 1, Data(i), views_[i].length) >= 0)
+                return false;
+        }
+        return true;
+    }
+
+protected:
+    const char* arena_ = nullptr;
+    const PeptideView* views_ = nullptr;
+    int size_ = 0;
+};
+
+// peptides as views of offset and length into one arena of the protein sequences,
+// so digestion copies no substring. A view is deduplicated by the polynomial hash
+// of its residues, taken in O(1) from the prefix hashes of the digested sequence.
+class PeptideStore
+{
+public:
+    typedef PeptideView View;
+
+    // the sequence is appended to the arena, at the returned offset
+    size_t Add(const std::string& sequence)
+    {
+        size_t offset = arena_.size();
+        arena_ += sequence;
+        return offset;
+    }
+
+    // prefix hashes of arena[offset, offset + length)
+    void Prefix(size_t offset, size_t length, std::vector<uint64_t>& prefix)
+    {
+        prefix.resize(length + 1);
+        prefix[0] = 0;
+        for(size_t i = 0; i < length; i++)
+        {
+            prefix[i + 1] = prefix[i] * kBase + (unsigned char) arena_[offset + i];
+        }
+        while (power_.size() <= length)
+        {
+            power_.push_back(power_.empty() ? 1 : power_.back() * kBase);
+        }
+    }
+
+    // hash of the residues [first, first + length) of the prefix
+    uint64_t Hash(const std::vector<uint64_t>& prefix, size_t first, size_t length) const
+    {
+        return prefix[first + length] - prefix[first] * power_[length];
+    }
+
+    // false if the peptide is stored already
+    bool Insert(size_t offset, size_t length, uint64_t hash)
+    {
+        Slot& slot = Probe(arena_.data() + offset, length, hash);
+        if (slot.index >= 0)
+            return false;
+        slot.hash = hash;
+        slot.index = (int) views_.size();
+        views_.push_back(View{(uint32_t) offset, (uint32_t) length});
+        return true;
+    }
+
+    // the peptide copied to the end of the arena, unless stored already
+    bool Insert(const char* peptide, size_t length)
+    {
+        uint64_t hash = 0;
+        for(size_t i = 0; i < length; i++)
+        {
+            hash = hash * kBase + (unsigned char) peptide[i];
+        }
+        Slot& slot = Probe(peptide, length, hash);
+        if (slot.index >= 0)
+            return false;
+        slot.hash = hash;
+        slot.index = (int) views_.size();
+        views_.push_back(View{(uint32_t) arena_.size(), (uint32_t) length});
+        arena_.append(peptide, length);
+        return true;
+    }
+
+    // residues of the arena from the offset
+    const char* At(size_t offset) const { return arena_.data() + offset; }
+
+    int Size() const { return (int) views_.size(); }
+    const View& ViewOf(int index) const { return views_[index]; }
+    const char* Data(int index) const { return arena_.data() + views_[index].offset; }
+
+    std::string Peptide(int index) const
+    {
+        return std::string(Data(index), views_[index].length);
+    }
+
+    // the views until the next Add or Insert
+    PeptideViews Views() const
+    {
+        return PeptideViews(arena_.data(), views_.data(), Size());
+    }
+
+    // the peptides made into strings, e.g., for the searching
+    std::unordered_set<std::string> Strings() const
+    {
+        std::unordered_set<std::string> peptides;
+        peptides.reserve(views_.size());
+        for(int i = 0; i < Size(); i++)
+        {
+            peptides.insert(Peptide(i));
+        }
+        return peptides;
+    }
+
+protected:
+    struct Slot
+    {
+        uint64_t hash = 0;
+        int index = -1;
+    };
+
+    // the low bits of the polynomial hash depend little on the first residues
+    static size_t Mix(uint64_t hash)
+    {
+        hash ^= hash >> 31;
+        hash *= 0x9E3779B97F4A7C15ULL;
+        return (size_t) (hash ^ (hash >> 29));
+    }
+
+    // the slot of the peptide, or the empty slot to insert it
+    Slot& Probe(const char* peptide, size_t length, uint64_t hash)
+    {
+        if ((views_.size() + 1) * 2 > slots_.size())
+            Grow();
+        size_t mask = slots_.size() - 1;
+        for(size_t i = Mix(hash) & mask; ; i = (i + 1) & mask)
+        {
+            Slot& slot = slots_[i];
+            if (slot.index < 0)
+                return slot;
+            const View& view = views_[slot.index];
+            if (slot.hash == hash && view.length == length &&
+                std::memcmp(arena_.data() + view.offset, peptide, length) == 0)
+                return slot;
+        }
+    }
+
+    void Grow()
+    {
+        std::vector<Slot> slots(slots_.empty() ? 1024 : slots_.size() * 2);
+        size_t mask = slots.size() - 1;
+        for(const auto& slot : slots_)
+        {
+            if (slot.index < 0)
+                continue;
+            size_t i = Mix(slot.hash) & mask;
+            while (slots[i].index >= 0)
+                i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+        slots_.swap(slots);
+    }
+
+    static const uint64_t kBase = 1000003ULL;
+
+    std::string arena_;
+    std::vector<View> views_;
+    std::vector<Slot> slots_;
+    std::vector<uint64_t> power_;
+};
+
+} // namespace protein
+} // namespace engine
+
+#endif
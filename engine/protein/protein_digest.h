@@ -2,11 +2,15 @@
 #define ENGINE_PROTEIN_PROTEIN_DIGEST_H_
 
 #include <vector>
+#include <deque>
 #include <string>
+#include <utility>
+#include <cstdint>
 #include <algorithm>
 #include <functional>
 #include <unordered_set>
 #include "protein_ptm.h"
+#include "peptide_store.h"
 
 namespace engine {
 namespace protein {
@@ -30,14 +34,21 @@ class Digestion
 {
 public:
     Digestion(): miss_cleavage_(2), min_length_(5), 
-        enzyme_(Proteases::Trypsin){}
+        enzyme_(Proteases::Trypsin), proteases_(1, Proteases::Trypsin){}
 
     int MissCleavage() { return miss_cleavage_; }
     int MinLength() { return min_length_; }
     Proteases Enzyme() { return enzyme_; }
     void set_min_length(int length) { min_length_ = length; }
     void set_miss_cleavage(int num) { miss_cleavage_ = num; }
-    void SetProtease(Proteases enzyme) { enzyme_ = enzyme; }
+    void SetProtease(Proteases enzyme) { enzyme_ = enzyme; proteases_.assign(1, enzyme); }
+    // the proteases of Digest, in the order of digestion
+    void SetProteases(const std::deque<Proteases>& enzymes)
+    {
+        proteases_.assign(enzymes.begin(), enzymes.end());
+        if (!proteases_.empty())
+            enzyme_ = proteases_.front();
+    }
 
     std::unordered_set<std::string> Sequences
         (const std::string seq, std::function<bool(const std::string&)> filter)
@@ -63,8 +74,59 @@ public:
         return seq_list;
     }
 
+    // the peptides of the store view [offset, offset + length) under the
+    // proteases in turn, added to the store as views. Each protease digests
+    // again the peptides of the ones before, as Sequences does over the sets,
+    // here over the intervals of the protein, with the cleavage sites of all
+    // the proteases found in one scan.
+    void Digest(PeptideStore& store, size_t offset, int length, 
+        std::function<bool(const char*, size_t)> filter)
+    {
+        const char* sequence = store.At(offset);
+        int n_enzyme = (int) proteases_.size();
+        cuts_.resize(n_enzyme);
+        for (auto& cuts : cuts_)
+        {
+            cuts.clear();
+        }
+        for (int i = 0; i < length; i++)
+        {
+            for (int k = 0; k < n_enzyme; k++)
+            {
+                if (IsCleavablePosition(proteases_[k], sequence, length, i))
+                    cuts_[k].push_back(i);
+            }
+        }
+
+        intervals_.clear();
+        visited_.clear();
+        Cleave(cuts_[0], -1, length - 1, sequence, filter);
+        for (int k = 1; k < n_enzyme; k++)
+        {
+            int size = (int) intervals_.size();
+            for (int i = 0; i < size; i++)
+            {
+                std::pair<int, int> interval = intervals_[i];
+                Cleave(cuts_[k], interval.first - 1, interval.second, sequence, filter);
+            }
+        }
+
+        store.Prefix(offset, length, prefix_);
+        for (const auto& interval : intervals_)
+        {
+            int size = interval.second - interval.first + 1;
+            store.Insert(offset + interval.first, size, 
+                store.Hash(prefix_, interval.first, size));
+        }
+    }
+
 protected:
     std::vector<int> FindCutOffPosition(const std::string& sequence)
+    {
+        return FindCutOffPosition(sequence.data(), (int) sequence.length());
+    }
+
+    std::vector<int> FindCutOffPosition(const char* sequence, int length)
     {
         //get cleavable position, make all possible peptide cutoff  positoins
         std::vector<int> cutoffs;
@@ -72,30 +134,68 @@ protected:
         cutoffs.push_back(-1); //trivial to include starting place
 
        
-        for (int i = 0; i < (int) sequence.length(); i++)
+        for (int i = 0; i < length; i++)
         {
-            if (IsCleavablePosition(sequence, i))    //enzyme
+            if (IsCleavablePosition(sequence, length, i))    //enzyme
             {
                 cutoffs.push_back(i);
             }
         }
-        if (!IsCleavablePosition(sequence, sequence.length() - 1))
+        if (!IsCleavablePosition(sequence, length, length - 1))
         {
-            cutoffs.push_back(sequence.length()- 1); //trivial to include ending place
+            cutoffs.push_back(length - 1); //trivial to include ending place
         }
 
         return cutoffs;
     }
         
     bool IsCleavablePosition(const std::string& sequence, int index)
+    {
+        return IsCleavablePosition(sequence.data(), (int) sequence.length(), index);
+    }
+
+    // the peptides between the cuts of (first, last], the sites of the
+    // protease inside and the ends, as Sequences cuts a peptide digested before
+    void Cleave(const std::vector<int>& sites, int first, int last,
+        const char* sequence, const std::function<bool(const char*, size_t)>& filter)
+    {
+        cutoffs_.clear();
+        cutoffs_.push_back(first);
+        for (auto it = std::upper_bound(sites.begin(), sites.end(), first); 
+            it != sites.end() && *it < last; it++)
+        {
+            cutoffs_.push_back(*it);
+        }
+        cutoffs_.push_back(last);
+
+        for (int i = 0; i <= miss_cleavage_; i++)
+        {
+            for (int j = 0; j <  (int) cutoffs_.size() - i - 1; j++)
+            {
+                int start = cutoffs_[j] + 1;
+                int end = cutoffs_[j + 1 + i];
+                if (end - start + 1 >= min_length_ && 
+                    filter(sequence + start, end - start + 1) &&
+                    visited_.insert(((uint64_t) start << 32) | (uint32_t) end).second)
+                    intervals_.push_back(std::make_pair(start, end));
+            }
+        }
+    }
+
+    bool IsCleavablePosition(const char* sequence, int length, int index)
+    {
+        return IsCleavablePosition(enzyme_, sequence, length, index);
+    }
+
+    static bool IsCleavablePosition(Proteases enzyme, const char* sequence, int length, int index)
     {
         char s = sequence[index];
-        switch (enzyme_)
+        switch (enzyme)
         {
             //cleaves peptides on the C-terminal side of lysine and arginine
             case Proteases::Trypsin:
                 //proline residue is on the carboxyl side of the cleavage site
-                if (index < (int) sequence.length() - 1 && sequence[index + 1] == 'P')
+                if (index < length - 1 && sequence[index + 1] == 'P')
                 {
                     return false;
                 }
@@ -114,7 +214,7 @@ protected:
                 break;
 
             case Proteases::Chymotrypsin:
-                if (index < (int) sequence.length() - 1 && sequence[index + 1] == 'P')
+                if (index < length - 1 && sequence[index + 1] == 'P')
                 {
                     return false;
                 }
@@ -125,7 +225,7 @@ protected:
                 break;
 
             case Proteases::GluC:
-                if (index < (int) sequence.length() - 1 && sequence[index + 1] == 'P')
+                if (index < length - 1 && sequence[index + 1] == 'P')
                 {
                     return false;
                 }
@@ -146,6 +246,13 @@ protected:
     int miss_cleavage_;
     int min_length_;
     Proteases enzyme_;
+    std::vector<Proteases> proteases_;
+    // buffers of Digest, kept over the proteins
+    std::vector<uint64_t> prefix_;
+    std::vector<std::vector<int>> cuts_;
+    std::vector<int> cutoffs_;
+    std::vector<std::pair<int, int>> intervals_;
+    std::unordered_set<uint64_t> visited_;
 
 };
 
@@ -24,6 +24,18 @@ public:
         return false;
     }
 
+    static bool ContainsNGlycanSiteIn(const char* sequence, size_t length)
+    {
+        for (size_t i = 0; i + 2 < length; i++)
+        {
+            char s = sequence[i];
+            char nxs = sequence[i + 2];
+            if (s == 'N' && (nxs == 'S' || nxs == 'T')) return true;
+        }
+
+        return false;
+    }
+
     static bool ContainsOGlycanSite(const std::string& sequence)
     {
         for (size_t i = 0; i < sequence.length(); i++)
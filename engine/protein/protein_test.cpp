@@ -4,7 +4,10 @@
 #include <string>
 #include <iostream>
 
+#include <deque>
+#include <random>
 #include "protein_digest.h"
+#include "modification.h"
 
 #include <fstream>
 #include <iostream>
@@ -36,3 +39,187 @@ BOOST_AUTO_TEST_CASE( Monosaccharide_test )
 
 
 
+// peptides of the proteases in turn, each digesting the peptide set before
+std::unordered_set<std::string> NestedDigestion(const std::vector<std::string>& proteins,
+    const std::deque<engine::protein::Proteases>& proteases, int miss_cleavage)
+{
+    engine::protein::Digestion digest;
+    digest.set_miss_cleavage(miss_cleavage);
+    digest.SetProtease(proteases.front());
+    std::unordered_set<std::string> peptides;
+    for(const auto& protein : proteins)
+    {
+        std::unordered_set<std::string> seqs = digest.Sequences(protein,
+            engine::protein::ProteinPTM::ContainsNGlycanSite);
+        peptides.insert(seqs.begin(), seqs.end());
+    }
+    for(int k = 1; k < (int) proteases.size(); k++)
+    {
+        digest.SetProtease(proteases[k]);
+        std::unordered_set<std::string> double_seqs;
+        for(const auto& seq : peptides)
+        {
+            std::unordered_set<std::string> seqs = digest.Sequences(seq,
+                engine::protein::ProteinPTM::ContainsNGlycanSite);
+            double_seqs.insert(seqs.begin(), seqs.end());
+        }
+        peptides.insert(double_seqs.begin(), double_seqs.end());
+    }
+    return peptides;
+}
+
+// peptides of the proteases in one pass into the store
+std::unordered_set<std::string> StoreDigestion(const std::vector<std::string>& proteins,
+    const std::deque<engine::protein::Proteases>& proteases, int miss_cleavage)
+{
+    engine::protein::Digestion digest;
+    digest.set_miss_cleavage(miss_cleavage);
+    digest.SetProteases(proteases);
+    engine::protein::PeptideStore store;
+    for(const auto& protein : proteins)
+    {
+        size_t offset = store.Add(protein);
+        digest.Digest(store, offset, (int) protein.length(),
+            engine::protein::ProteinPTM::ContainsNGlycanSiteIn);
+    }
+    return store.Strings();
+}
+
+BOOST_AUTO_TEST_CASE( peptide_store_test ) 
+{
+    // the views of trypsin then gluc in one pass equal the strings of the nested digestion
+    std::vector<std::string> proteins {
+        "MSALGAVIALLLWGQLFAVDSGNDSVTDIADDGCPKPPEIAHGYVEHSVRYQCKNYYKLRTEGDGVYTLND",
+        "NGTKNVSERLNASKDLNETRKPNGSEVVNCTDRAANGTWNVSEPEGLNVTKNGS"};
+    engine::protein::Digestion digest;
+    std::unordered_set<std::string> expected;
+    for(const auto& protein : proteins)
+    {
+        std::unordered_set<std::string> seqs = digest.Sequences(protein,
+            engine::protein::ProteinPTM::ContainsNGlycanSite);
+        expected.insert(seqs.begin(), seqs.end());
+    }
+    digest.SetProtease(engine::protein::Proteases::GluC);
+    std::unordered_set<std::string> double_seqs;
+    for(const auto& seq : expected)
+    {
+        std::unordered_set<std::string> seqs = digest.Sequences(seq,
+            engine::protein::ProteinPTM::ContainsNGlycanSite);
+        double_seqs.insert(seqs.begin(), seqs.end());
+    }
+    expected.insert(double_seqs.begin(), double_seqs.end());
+
+    engine::protein::PeptideStore store;
+    digest.SetProteases({engine::protein::Proteases::Trypsin, engine::protein::Proteases::GluC});
+    for(const auto& protein : proteins)
+    {
+        size_t offset = store.Add(protein);
+        digest.Digest(store, offset, (int) protein.length(),
+            engine::protein::ProteinPTM::ContainsNGlycanSiteIn);
+    }
+    BOOST_CHECK(store.Size() == (int) expected.size());
+    BOOST_CHECK(store.Strings() == expected);
+}
+
+BOOST_AUTO_TEST_CASE( multi_protease_test ) 
+{
+    using engine::protein::Proteases;
+    std::vector<std::string> proteins {
+        "MSALGAVIALLLWGQLFAVDSGNDSVTDIADDGCPKPPEIAHGYVEHSVRYQCKNYYKLRTEGDGVYTLND",
+        "NGTKNVSERLNASKDLNETRKPNGSEVVNCTDRAANGTWNVSEPEGLNVTKNGS",
+        "KRNWSFYENATKPDEWNLTRYPFNGSDKEWNQTAPRK"};
+    std::vector<std::deque<Proteases>> orders {
+        {Proteases::Trypsin, Proteases::GluC, Proteases::Chymotrypsin},
+        {Proteases::Pepsin, Proteases::Trypsin, Proteases::GluC},
+        {Proteases::GluC, Proteases::Chymotrypsin, Proteases::Trypsin}};
+    for(const auto& proteases : orders)
+    {
+        for(int miss_cleavage = 0; miss_cleavage <= 3; miss_cleavage++)
+        {
+            BOOST_CHECK(StoreDigestion(proteins, proteases, miss_cleavage) == 
+                NestedDigestion(proteins, proteases, miss_cleavage));
+        }
+    }
+
+    // random proteins rich in sites, upto three proteases
+    std::mt19937 generator(1);
+    const std::string residues = "ACDEFGHIKLMNPQRSTVWYNNSTKRPE";
+    for(int t = 0; t < 200; t++)
+    {
+        std::vector<std::string> random_proteins(1);
+        int length = 20 + generator() % 200;
+        for(int i = 0; i < length; i++)
+        {
+            random_proteins[0] += residues[generator() % residues.length()];
+        }
+        std::deque<Proteases> proteases;
+        int n_protease = 1 + generator() % 3;
+        for(int k = 0; k < n_protease; k++)
+        {
+            proteases.push_back(static_cast<Proteases>(generator() % 4));
+        }
+        int miss_cleavage = generator() % 3;
+        BOOST_CHECK(StoreDigestion(random_proteins, proteases, miss_cleavage) == 
+            NestedDigestion(random_proteins, proteases, miss_cleavage));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( interpret_test ) 
+{
+    std::string seq = "VVLHP$NYSQVD$#@NQ";
+    BOOST_CHECK(engine::protein::Modifier::Interpret(seq) == "VVLHPM*NYSQVDM*Q^N^NQ");
+    std::string out = "1,";
+    engine::protein::Modifier::Interpret("N@K", out);
+    BOOST_CHECK(out == "1,NN^K");
+}
+
+BOOST_AUTO_TEST_CASE( max_modifications_test ) 
+{
+    // oxidation, then deamidation of N or of Q, the site N of NGT kept unmodified
+    std::unordered_set<std::string> peptides {"MNGTQM"};
+    std::unordered_set<std::string> all = engine::protein::Modifier::DynamicModification(
+        peptides, engine::protein::ProteinPTM::ContainsNGlycanSite);
+    BOOST_CHECK(all.size() == 8);
+    BOOST_CHECK(all.find("$NGT#$") != all.end());
+
+    std::unordered_set<std::string> capped = engine::protein::Modifier::DynamicModification(
+        peptides, engine::protein::ProteinPTM::ContainsNGlycanSite, true, true, 1);
+    std::unordered_set<std::string> expected {"MNGTQM", "$NGTQM", "MNGTQ$", "MNGT#M"};
+    BOOST_CHECK(capped == expected);
+
+    // sites beyond a mask are left unmodified
+    std::unordered_set<std::string> long_peptides {std::string(70, 'M') + "NGT"};
+    std::unordered_set<std::string> unmodified = engine::protein::Modifier::DynamicModification(
+        long_peptides, engine::protein::ProteinPTM::ContainsNGlycanSite);
+    BOOST_CHECK(unmodified == long_peptides);
+    int visits = 0;
+    engine::protein::Modifier::Combination(64, 1, [&](uint64_t mask, int) { visits++; });
+    BOOST_CHECK(visits == 1);
+}
+
+BOOST_AUTO_TEST_CASE( store_modification_test ) 
+{
+    // the variants of the store views equal the variants of the strings
+    std::vector<std::string> proteins {
+        "MSALGAVIALLLWGQLFAVDSGNDSVTDIADDGCPKPPEIAHGYVEHSVRYQCKNYYKLRTEGDGVYTLND",
+        "NGTKNVSERLNASKDLNETRKPNGSEVVNCTDRAANGTWNVSEPEGLNVTKNGSMNQTMK"};
+    engine::protein::Digestion digest;
+    engine::protein::PeptideStore store;
+    for(const auto& protein : proteins)
+    {
+        size_t offset = store.Add(protein);
+        digest.Digest(store, offset, (int) protein.length(),
+            engine::protein::ProteinPTM::ContainsNGlycanSiteIn);
+    }
+    std::unordered_set<std::string> peptides = store.Strings();
+    for(int max_modifications = 0; max_modifications <= 2; max_modifications++)
+    {
+        std::unordered_set<std::string> expected = engine::protein::Modifier::DynamicModification(
+            peptides, engine::protein::ProteinPTM::ContainsNGlycanSite, true, true, max_modifications);
+        engine::protein::PeptideStore modified;
+        engine::protein::Modifier::DynamicModification(store, modified, 
+            engine::protein::ProteinPTM::ContainsNGlycanSiteIn, true, true, max_modifications);
+        BOOST_CHECK(modified.Size() == (int) expected.size());
+        BOOST_CHECK(modified.Strings() == expected);
+    }
+}
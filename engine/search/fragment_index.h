@@ -0,0 +1,225 @@
+#ifndef ENGINE_SEARCH_FRAGMENT_INDEX_H_
+#define ENGINE_SEARCH_FRAGMENT_INDEX_H_
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "../protein/protein_ptm.h"
+#include "../protein/peptide_store.h"
+#include "../../util/parallel/work_stealing_pool.h"
+#include "search_helper.h"
+
+namespace engine{
+namespace search{
+
+// fragment ions of the whole peptide database, built once and read-only after.
+// An entry is a peptide with its glycosylation site. The ions without the
+// glycan are sorted in one array, while the ions carrying the glycan are kept
+// as a sorted ladder per entry, to be shifted by the glycan mass at query.
+// The peptides are views in order of residues, and the entries in order of peptides.
+class FragmentIndex
+{
+public:
+    FragmentIndex() = default;
+    // the peptides may be views into the arena of the index
+    FragmentIndex(const FragmentIndex&) = delete;
+    FragmentIndex& operator=(const FragmentIndex&) = delete;
+
+    // duplicated peptides once, copied to the arena of the index
+    void Build(const std::vector<std::string>& peptides, util::parallel::WorkStealingPool& pool)
+    {
+        store_ = engine::protein::PeptideStore();
+        for(const auto& seq : peptides)
+        {
+            store_.Insert(seq.data(), seq.length());
+        }
+        Build(store_.Views(), pool);
+    }
+
+    // distinct peptides, as views into an arena that outlives the index.
+    // The peptides are cut in parts built by the workers of the pool.
+    void Build(const engine::protein::PeptideViews& peptides, util::parallel::WorkStealingPool& pool)
+    {
+        const char* arena = peptides.Arena();
+        views_.assign(peptides.Views(), peptides.Views() + peptides.Size());
+        std::sort(views_.begin(), views_.end(), [arena](
+            const engine::protein::PeptideView& a, const engine::protein::PeptideView& b)
+        {
+            int order = std::memcmp(arena + a.offset, arena + b.offset, std::min(a.length, b.length));
+            return order < 0 || (order == 0 && a.length < b.length);
+        });
+        peptides_ = engine::protein::PeptideViews(arena, views_.data(), (int) views_.size());
+
+        int n_part = pool.Size() * kParts;
+        std::vector<Part> parts(n_part);
+        pool.Run(n_part, [this, n_part, &parts](int w, int first, int last)
+        {
+            for(int t = first; t < last; t++)
+            {
+                BuildPart(t, n_part, parts[t]);
+            }
+        }, 1);
+
+        // concatenate the parts in order of peptides
+        entry_peptides_.clear();
+        entry_sites_.clear();
+        ladder_offsets_.assign(1, 0);
+        ladder_masses_.clear();
+        peptide_masses_.clear();
+        std::vector<std::pair<double, int>> fragments;
+        std::vector<int> bounds(1, 0);
+        for(const auto& part : parts)
+        {
+            int entry_offset = (int) entry_peptides_.size();
+            int ladder_offset = (int) ladder_masses_.size();
+            entry_peptides_.insert(entry_peptides_.end(), part.entry_peptides.begin(), part.entry_peptides.end());
+            entry_sites_.insert(entry_sites_.end(), part.entry_sites.begin(), part.entry_sites.end());
+            for(int i = 1; i < (int) part.ladder_offsets.size(); i++)
+            {
+                ladder_offsets_.push_back(part.ladder_offsets[i] + ladder_offset);
+            }
+            ladder_masses_.insert(ladder_masses_.end(), part.ladder_masses.begin(), part.ladder_masses.end());
+            peptide_masses_.insert(peptide_masses_.end(), part.peptide_masses.begin(), part.peptide_masses.end());
+            for(const auto& it : part.fragments)
+            {
+                fragments.push_back(std::make_pair(it.first, it.second + entry_offset));
+            }
+            bounds.push_back((int) fragments.size());
+        }
+        // each part is sorted already
+        for(int i = 2; i < (int) bounds.size(); i++)
+        {
+            std::inplace_merge(fragments.begin(), fragments.begin() + bounds[i-1],
+                fragments.begin() + bounds[i]);
+        }
+        masses_.resize(fragments.size());
+        entries_.resize(fragments.size());
+        for(int i = 0; i < (int) fragments.size(); i++)
+        {
+            masses_[i] = fragments[i].first;
+            entries_[i] = fragments[i].second;
+        }
+        Attach(peptides_, Arrays{(int) entry_peptides_.size(), (int) masses_.size(), (int) ladder_masses_.size(),
+            entry_peptides_.data(), entry_sites_.data(), masses_.data(), entries_.data(),
+            ladder_offsets_.data(), ladder_masses_.data(), peptide_masses_.data()});
+    }
+
+    // the flat arrays of the index, owned by the index after Build, 
+    // or by the caller after Attach, e.g., a mapped database file
+    struct Arrays
+    {
+        int entry_size;
+        int fragment_size;
+        int ladder_size;
+        const int* entry_peptides;
+        const int* entry_sites;
+        const double* masses;
+        const int* entries;
+        const int* ladder_offsets; // entry_size + 1
+        const double* ladder_masses;
+        const double* peptide_masses; // of the ladders, per peptide
+    };
+
+    const Arrays& ArraysRef() const { return arrays_; }
+    const engine::protein::PeptideViews& PeptidesRef() const { return peptides_; }
+
+    // peptides are the distinct sequences the entries refer to, in order of
+    // residues, and the entries in order of peptides, as Build
+    void Attach(const engine::protein::PeptideViews& peptides, const Arrays& arrays)
+    {
+        peptides_ = peptides;
+        arrays_ = arrays;
+    }
+
+    // entries of the peptide in [first, second)
+    std::pair<int, int> Entries(const std::string& peptide) const
+    {
+        int p = peptides_.Find(peptide.data(), peptide.length());
+        if (p < 0)
+            return std::make_pair(0, 0);
+        const int* begin = arrays_.entry_peptides;
+        const int* end = arrays_.entry_peptides + arrays_.entry_size;
+        std::pair<const int*, const int*> range = std::equal_range(begin, end, p);
+        return std::make_pair((int) (range.first - begin), (int) (range.second - begin));
+    }
+
+    int EntrySize() const { return arrays_.entry_size; }
+    std::string Peptide(int entry) const { return peptides_.Peptide(arrays_.entry_peptides[entry]); }
+    int Site(int entry) const { return arrays_.entry_sites[entry]; }
+
+    // sorted ions without glycan, with the entry of each
+    int FragmentSize() const { return arrays_.fragment_size; }
+    const double* Masses() const { return arrays_.masses; }
+    const int* Entries() const { return arrays_.entries; }
+    // sorted ions with glycan of the entry, without the glycan mass
+    const double* LadderBegin(int entry) const 
+        { return arrays_.ladder_masses + arrays_.ladder_offsets[entry]; }
+    const double* LadderEnd(int entry) const 
+        { return arrays_.ladder_masses + arrays_.ladder_offsets[entry + 1]; }
+
+protected:
+    struct Part
+    {
+        std::vector<int> entry_peptides;
+        std::vector<int> entry_sites;
+        std::vector<int> ladder_offsets {0};
+        std::vector<double> ladder_masses;
+        std::vector<double> peptide_masses; // of the peptides of the part
+        std::vector<std::pair<double, int>> fragments; // mass, entry in part
+    };
+
+    void BuildPart(int index, int n_part, Part& part) const
+    {
+        int size = peptides_.Size();
+        int first = (int) ((long) size * index / n_part);
+        int last = (int) ((long) size * (index + 1) / n_part);
+        util::mass::PeptideLadder ladder;
+        std::vector<double> masses;
+        std::string peptide;
+        for(int p = first; p < last; p++)
+        {
+            peptide.assign(peptides_.Data(p), peptides_.Length(p));
+            ladder.Set(peptide);
+            part.peptide_masses.push_back(ladder.Mass());
+            for (int pos : engine::protein::ProteinPTM::FindNGlycanSite(peptide))
+            {
+                int entry = (int) part.entry_peptides.size();
+                part.entry_peptides.push_back(p);
+                part.entry_sites.push_back(pos);
+                masses.clear();
+                ladder.Fragments(pos, masses);
+                for(double mass : masses)
+                {
+                    part.fragments.push_back(std::make_pair(mass, entry));
+                }
+                size_t begin = part.ladder_masses.size();
+                ladder.GlycoFragments(pos, part.ladder_masses);
+                std::sort(part.ladder_masses.begin() + begin, part.ladder_masses.end());
+                part.ladder_offsets.push_back((int) part.ladder_masses.size());
+            }
+        }
+        std::sort(part.fragments.begin(), part.fragments.end());
+    }
+
+    // parts per worker of the pool
+    static const int kParts = 4;
+
+    engine::protein::PeptideStore store_; // of the strings built from
+    std::vector<engine::protein::PeptideView> views_;
+    engine::protein::PeptideViews peptides_;
+    std::vector<int> entry_peptides_;
+    std::vector<int> entry_sites_;
+    std::vector<double> masses_;
+    std::vector<int> entries_;
+    std::vector<int> ladder_offsets_;
+    std::vector<double> ladder_masses_;
+    std::vector<double> peptide_masses_;
+    Arrays arrays_ {};
+};
+
+} // namespace search
+} // namespace engine
+
+#endif
@@ -0,0 +1,82 @@
+#define BOOST_TEST_MODULE FragmentIndexTest
+#include <boost/test/unit_test.hpp>
+#include "fragment_index.h"
+
+
+namespace engine{
+namespace search {
+
+BOOST_AUTO_TEST_CASE( fragment_index_test ) 
+{
+    std::vector<std::string> peptides {"AVNKSTR", "LPNGTEK", "NASNKTAVR", "LPNGTEK", "PEPTIDEK"};
+    FragmentIndex index;
+    util::parallel::WorkStealingPool pool(3);
+    index.Build(peptides, pool);
+
+    // one entry per site, duplicated peptides once
+    BOOST_CHECK(index.EntrySize() == 4);
+    BOOST_CHECK(index.Entries("PEPTIDEK").first == index.Entries("PEPTIDEK").second);
+    std::pair<int, int> entries = index.Entries("NASNKTAVR");
+    BOOST_CHECK(entries.second - entries.first == 2);
+
+    std::vector<double> masses(index.Masses(), index.Masses() + index.FragmentSize());
+    BOOST_CHECK(std::is_sorted(masses.begin(), masses.end()));
+    util::mass::PeptideLadder peptide_ladder;
+    for(int e = 0; e < index.EntrySize(); e++)
+    {
+        peptide_ladder.Set(index.Peptide(e));
+        int pos = index.Site(e);
+        std::vector<double> expect = SearchHelper::ComputeNonePTMPeptideMass(peptide_ladder, pos);
+        int count = 0;
+        for(int i = 0; i < (int) masses.size(); i++)
+        {
+            if (index.Entries()[i] == e) count++;
+        }
+        BOOST_CHECK(count == (int) expect.size());
+
+        std::vector<double> ladder(index.LadderBegin(e), index.LadderEnd(e));
+        std::vector<double> ptm = SearchHelper::ComputePTMPeptideMass(peptide_ladder, pos);
+        std::sort(ptm.begin(), ptm.end());
+        BOOST_CHECK(ladder == ptm);
+    }
+
+    // a view of arrays owned elsewhere
+    FragmentIndex view;
+    view.Attach(index.PeptidesRef(), index.ArraysRef());
+    BOOST_CHECK(view.EntrySize() == index.EntrySize());
+    BOOST_CHECK(view.Entries("NASNKTAVR") == entries);
+    BOOST_CHECK(view.Masses() == index.Masses());
+}
+
+BOOST_AUTO_TEST_CASE( peptide_ladder_test ) 
+{
+    // the table and prefix sums as the residues summed in turn
+    std::string peptide = "CNGTmQC";
+    std::vector<double> prefix;
+    util::mass::PeptideMass::Prefix(peptide, prefix);
+    for(int i = 0; i <= (int) peptide.length(); i++)
+    {
+        BOOST_CHECK(prefix[i] == util::mass::PeptideMass::Compute(peptide.substr(0, i)));
+    }
+    BOOST_CHECK(util::mass::PeptideMass::GetAminoAcidMW('m') == 131.04049);
+    BOOST_CHECK(util::mass::PeptideMass::GetAminoAcidMW('C') == 103.00919);
+
+    // ions of one site, b and c before y and z
+    util::mass::PeptideLadder ladder;
+    ladder.Set(peptide);
+    BOOST_CHECK(ladder.Mass() == util::mass::PeptideMass::Compute(peptide));
+    std::vector<double> ions;
+    ladder.Fragments(1, ions);
+    BOOST_CHECK(ions.size() == 12);
+    BOOST_CHECK(ions[0] == util::mass::IonMass::Compute(18.0105 + 103.00919, util::mass::IonType::b));
+    ions.clear();
+    ladder.GlycoFragments(1, ions);
+    BOOST_CHECK(ions.size() == 12);
+    BOOST_CHECK(ions[0] == util::mass::IonMass::Compute(prefix[1] + 114.04293, util::mass::IonType::b));
+    // y at the site, of the total less the prefix
+    BOOST_CHECK(fabs(ions[ions.size() - 2] - util::mass::IonMass::Compute(
+        util::mass::PeptideMass::Compute(peptide.substr(1)), util::mass::IonType::y)) < 1e-9);
+}
+
+} // namespace search
+} // namespace engine
@@ -8,37 +8,58 @@
 #include "../../model/glycan/glycan.h"
 #include "../../util/mass/spectrum.h"
 #include "../../util/mass/peptide.h"
+#include "../protein/peptide_store.h"
 #include "../../algorithm/search/search.h"
 
 namespace engine{
 namespace search{
 
+// the index is only read by Match after Init, so that one matcher
+// can be shared by the searching threads.
 class PrecursorMatcher
 {
 public:
-    PrecursorMatcher(std::unique_ptr<algorithm::search::ISearch<std::string>> searcher): 
+    PrecursorMatcher(std::unique_ptr<algorithm::search::ISearch<int>> searcher): 
         searcher_(std::move(searcher)){}
 
+    // duplicated peptides once, copied to the arena of the matcher
     void Init(const std::vector<std::string>& peptides, 
         const std::unordered_map<std::string, std::unique_ptr<model::glycan::Glycan>>& glycans)
     {
         for(const auto& it : peptides)
         {
-            std::shared_ptr<algorithm::search::Point<std::string>> seq = 
-                std::make_shared<algorithm::search::Point<std::string>>(util::mass::PeptideMass::Compute(it), it);
-            peptides_.push_back(std::move(seq));
+            store_.Insert(it.data(), it.length());
+        }
+        std::vector<double> masses;
+        for(int i = 0; i < store_.Size(); i++)
+        {
+            masses.push_back(util::mass::PeptideMass::Compute(store_.Data(i), store_.ViewOf(i).length));
+        }
+        Init(store_.Views(), masses.data(), glycans);
+    }
+
+    // peptides as views into an arena that outlives the matcher, with the
+    // masses computed before, e.g., from the search database
+    void Init(const engine::protein::PeptideViews& peptides, const double* masses,
+        const std::unordered_map<std::string, std::unique_ptr<model::glycan::Glycan>>& glycans)
+    {
+        peptides_ = peptides;
+        for(int i = 0; i < peptides.Size(); i++)
+        {
+            points_.push_back(std::make_shared<algorithm::search::Point<int>>(masses[i], i));
         }
         
         for(const auto& it : glycans)
         {
             glycans_.push_back(it.second.get());
         }
-        searcher_->Init(peptides_);
+        searcher_->Init(points_);
     }
 
-    std::unordered_map<std::string, std::vector<model::glycan::Glycan*>> Match(double precursor, int charge)
+    std::unordered_map<std::string, std::vector<model::glycan::Glycan*>> Match(double precursor, int charge) const
     {
         std::unordered_map<std::string, std::vector<model::glycan::Glycan*>> results;
+        std::string seq;
         double mass = util::mass::SpectrumMass::Compute(precursor, charge);
 
         
@@ -48,8 +69,8 @@ public:
             if (target <= 0)
                 continue;
 
-            std::vector<std::string> peptides = searcher_->Search(target, mass);
-            if (peptides_.size() == 0)
+            std::vector<int> peptides = searcher_->Search(target, mass);
+            if (points_.size() == 0)
                 continue;
                 
             // check pentacore
@@ -59,12 +80,10 @@ public:
                 || composition.find(model::glycan::Monosaccharide::GlcNAc)->second < 3)
                 continue;
 
-            for(const auto& seq : peptides)
+            // a key is copied only for the peptides new to the results
+            for(int p : peptides)
             {
-                if(results.find(seq) == results.end())
-                {
-                    results[seq] = std::vector<model::glycan::Glycan*>();
-                }
+                seq.assign(peptides_.Data(p), peptides_.Length(p));
                 results[seq].push_back(glycan);
             }
         }
@@ -72,8 +91,10 @@ public:
     }
 
 protected:
-    std::unique_ptr<algorithm::search::ISearch<std::string>> searcher_;
-    std::vector<std::shared_ptr<algorithm::search::Point<std::string>>> peptides_;
+    std::unique_ptr<algorithm::search::ISearch<int>> searcher_;
+    engine::protein::PeptideStore store_; // of the strings initialized from
+    engine::protein::PeptideViews peptides_;
+    std::vector<std::shared_ptr<algorithm::search::Point<int>>> points_;
     std::vector<model::glycan::Glycan*> glycans_;
 
 }; 
@@ -4,19 +4,29 @@
 #include <string>
 #include <queue> 
 #include <memory>
+#include <algorithm>
 #include <numeric>
 #include <unordered_map>
 #include <unordered_set>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <chrono>
 
 #include "../../algorithm/search/search.h"
+#include "../../algorithm/queue/monotone_queue.h"
+#include "../../algorithm/queue/queue_trace.h"
 #include "../../model/glycan/glycan.h"
 #include "../../model/glycan/nglycan_complex.h"
 #include "../../model/glycan/nglycan_hybrid.h"
 #include "../../model/glycan/highmannose.h"
 #include "../../model/spectrum/spectrum.h"
 #include "../../util/mass/ion.h"
+#include "../../util/mass/ladder.h"
 #include "../../util/mass/spectrum.h"
 #include "../../util/mass/glycan.h"
+#include "../glycan/glycan_containment.h"
+#include "../glycan/glycan_dag.h"
 #include "search_glycan_helper.h"
 
 
@@ -36,20 +46,67 @@ public:
     std::unordered_map<std::string, std::unordered_set<int>> Search(
         const std::vector<model::spectrum::Peak>& peaks, int max_charge, 
         const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidates)
+    {
+        Prepare(peaks, max_charge);
+        return SearchPrepared(peaks, candidates);
+    }
+
+    // index the peaks of a spectrum once, for the searches of several
+    // candidate sets, e.g., the target and the decoy peptides
+    void Prepare(const std::vector<model::spectrum::Peak>& peaks, int max_charge)
+    {
+        if (fragments_ != nullptr)
+            InitPeakPoints(peaks, max_charge);
+        else
+            InitSearch(peaks, max_charge);
+        InitBound(peaks, max_charge);
+        InitBudget();
+    }
+
+    // search the candidates against the peaks of the last Prepare, the matched
+    // peptides of the candidates, if any, bound the search by the branch and bound
+    std::unordered_map<std::string, std::unordered_set<int>> SearchPrepared(
+        const std::vector<model::spectrum::Peak>& peaks,
+        const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidates,
+        const std::unordered_map<std::string, std::unordered_set<int>>* peptide_results = nullptr)
     {
         // init search engine
-        InitSearch(peaks, max_charge);
+        std::unordered_map<std::string, std::unordered_set<int>> results;
+        if (exceeded_)
+            return results;
+        if (fragments_ != nullptr)
+            InitShiftMatch(candidates);
+        InitContainment(candidates);
+        InitTiers(peaks, peptide_results);
+        beam_.clear();
+        live_.clear();
+
+        if (dag_ != nullptr)
+        {
+            // dp, collecting the matches of the lattice nodes
+            SweepDynamicProgramming(peaks, candidates, results);
+            if (exceeded_)
+                results.clear();
+            return results;
+        }
 
         // init peak nodes
         std::unordered_map<double, std::unique_ptr<PeakNode>> peak_nodes_map;
-        std::priority_queue<PeakNode*, std::vector<PeakNode*>, PeakNodeComparison> queue;
-        InitPriorityQueue(candidates, peak_nodes_map, queue);
-
-        // dp
-        auto dp_results = DynamicProgramming(peaks, peak_nodes_map, queue);
+        std::vector<PeakNode*> dp_results;
+        if (bucket_queue_)
+        {
+            algorithm::queue::MonotoneQueue<PeakNode*, PeakNodeMass> queue;
+            dp_results = QueueDynamicProgramming(peaks, candidates, peak_nodes_map, queue);
+        }
+        else
+        {
+            std::priority_queue<PeakNode*, std::vector<PeakNode*>, PeakNodeComparison> queue;
+            dp_results = QueueDynamicProgramming(peaks, candidates, peak_nodes_map, queue);
+        }
 
         // filter results
-        std::unordered_map<std::string, std::unordered_set<int>> results;
+        if (exceeded_)
+            return results;
         for(const auto& node : dp_results)
         {
             for(const auto& it : node->Matches())
@@ -82,67 +139,138 @@ public:
 
     bool Satisify(const std::string& identified_glycan_id, const model::glycan::Glycan* glycan) const
     {
-        const std::vector<int> identified_glycan_table = 
-            glycans_map_.find(identified_glycan_id)->second->TableConst();
-        const std::vector<int> candidate_glycan_table = glycan->TableConst();
-        if (candidate_glycan_table.size() != identified_glycan_table.size())
-            return false;
-        for(int i = 0; i < (int) identified_glycan_table.size(); i++)
-        {
-            if (candidate_glycan_table[i] < identified_glycan_table[i])
-                return false;
-        }
+        return Satisify(glycans_map_.find(identified_glycan_id)->second.get(), glycan);
+    }
 
-        // check terminal 
-        if ((int) identified_glycan_table.size() == 24)
-        {
-            for(int i = 0; i < 4; i++)
-            {
-                if ( (identified_glycan_table[12 + i] > 0 || identified_glycan_table[16 + i] > 0
-                        ) && identified_glycan_table[4 + i] != candidate_glycan_table[4 + i])
-                        return false;
-            }
-            
-        }
-        else if ((int) identified_glycan_table.size() == 16)
-        {
-            for (int i = 0; i < 2; i++)
-            {
-                if ((identified_glycan_table[10 + i] > 0 || identified_glycan_table[12 + i] > 0
-                        ) && identified_glycan_table[6 + i] != candidate_glycan_table[6 + i])
-                    return false;
-            }
+    bool Satisify(const model::glycan::Glycan* identified_glycan, const model::glycan::Glycan* glycan) const
+    {
+        if (subsumption_ != nullptr)
+            return subsumption_->Contains(glycan->Index(), identified_glycan->Index());
+        return engine::glycan::GlycanContainment::Contains(glycan, identified_glycan);
+    }
 
-        }
-        return true;
+    // match Y ions by shifting the spectrum with peptide mass against
+    // the sorted glycan masses of library, instead of the searcher
+    void set_shift_match(const std::vector<double>* fragments, 
+        model::spectrum::ToleranceBy type, double tol)
+    { 
+        fragments_ = fragments; 
+        type_ = type;
+        tolerance_ = tol;
     }
 
-    double ComputePeptideMass(const std::string seq)
+    // ms2 tolerance from the next Prepare, of the peak search and the shift match
+    void set_tolerance(double tol)
     {
-        if (peptide_mass_.find(seq) == peptide_mass_.end())
-        {
-            peptide_mass_[seq] = util::mass::PeptideMass::Compute(seq);
-        }
-        return peptide_mass_[seq];
+        searcher_->set_tolerance(tol);
+        tolerance_ = tol;
     }
+    void set_tolerance_by(model::spectrum::ToleranceBy type) { type_ = type; }
+
+    // sweep the mass sorted lattice of library instead of the priority queue
+    void set_dag(const engine::glycan::GlycanDAG* dag)
+    {
+        dag_ = dag;
+        InitRoots();
+    }
+
+    // stop the sweep of a peptide once none of its pairs can reach the top k
+    // scores of the analyzer, with the peptide scores given to SearchPrepared.
+    // Exact: a pair scores the union of the peaks of the matched substructures,
+    // all matched by the swept nodes or of the heavier peaks, which bound it.
+    // Of the lattice sweep only, and of the spectra without a peak below 1 in
+    // intensity, as a peak of negative log could raise the score it leaves.
+    void set_branch_bound(bool branch_bound) { branch_bound_ = branch_bound; }
+    // the number of top scores kept by the analyzer, of the branch and bound
+    void set_top_k(int top_k) { top_k_ = top_k; }
+    // extend at most the top width glycans by score per peptide and
+    // number of monosaccharides, 0 for unlimited. A glycan evicted from the beam
+    // releases its queued children, which are not extended unless another
+    // parent in the beam reached them.
+    void set_beam_width(int beam_width) { beam_width_ = beam_width; }
+
+    // pop the peak nodes from a monotone bucket queue instead of the binary heap,
+    // valid since a child is heavier than its parent by a monosaccharide
+    void set_bucket_queue(bool bucket_queue) { bucket_queue_ = bucket_queue; }
+
+    // precomputed containment of the glycan library, optional
+    void set_subsumption(const engine::glycan::SubsumptionMatrix* subsumption)
+        { subsumption_ = subsumption; }
+
+    // ladders shared with the other searchers of the thread
+    void set_ladders(util::mass::PeptideLadders* ladders) { ladders_ = ladders; }
+
+    // of the ladder of the peptide, set once
+    double ComputePeptideMass(const std::string& seq)
+    {
+        return (ladders_ != nullptr ? *ladders_ : own_ladders_).Mass(seq);
+    }
+
+    // number of peak nodes created by the dp
+    long Expanded() const { return expanded_; }
+    void set_expanded(long expanded) { expanded_ = expanded; }
+
+    // stop the dp of a spectrum once it creates more peak nodes, or runs longer
+    // in seconds since Prepare, than the budget, 0 for unlimited. The searches
+    // of an exceeded spectrum return nothing until the next Prepare.
+    void set_budget(long nodes, double seconds)
+    {
+        budget_nodes_ = nodes;
+        budget_seconds_ = seconds;
+    }
+    bool Exceeded() const { return exceeded_; }
     
 
+    // record the queue operations of each spectrum, as a trace of masses
+    void set_trace(std::vector<std::vector<double>>* traces) { traces_ = traces; }
+
 protected:
+    template <class Queue>
+    std::vector<PeakNode*> QueueDynamicProgramming(
+        const std::vector<model::spectrum::Peak>& peaks,
+        const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidates,
+        std::unordered_map<double, std::unique_ptr<PeakNode>>& peak_nodes_map,
+        Queue& queue)
+    {
+        std::vector<PeakNode*> dp_results;
+        if (traces_ != nullptr)
+        {
+            traces_->emplace_back();
+            algorithm::queue::TracedQueue<Queue, PeakNodeMass> traced(queue, traces_->back());
+            InitPriorityQueue(candidates, peak_nodes_map, traced);
+            dp_results = DynamicProgramming(peaks, peak_nodes_map, traced);
+        }
+        else
+        {
+            InitPriorityQueue(candidates, peak_nodes_map, queue);
+            dp_results = DynamicProgramming(peaks, peak_nodes_map, queue);
+        }
+        expanded_ += (long) peak_nodes_map.size();
+        spectrum_nodes_ += (long) peak_nodes_map.size();
+        return dp_results;
+    }
+
+    // queue pops the peak nodes by increasing mass
+    template <class Queue>
     std::vector<PeakNode*> DynamicProgramming(
         const std::vector<model::spectrum::Peak>& peaks,
         std::unordered_map<double, std::unique_ptr<PeakNode>>& peak_nodes_map,
-        std::priority_queue<PeakNode*, std::vector<PeakNode*>, PeakNodeComparison>& queue)
+        Queue& queue)
     {
         std::vector<PeakNode*> matched_nodes;
         while (queue.size() > 0)
         {
+            if (OverBudget((long) peak_nodes_map.size()))
+                break;
+
             // get node
             PeakNode* node = queue.top();
             queue.pop();
 
             // // match peaks
             double target = node->Mass();
-            std::vector<int> matched = searcher_->Search(target);
+            std::vector<int> matched = fragments_ != nullptr ?
+                ShiftMatch(node) : searcher_->Search(target);
 
             // max if matched a peak
             node->Max(peaks);
@@ -162,15 +290,25 @@ protected:
             for(const auto& it : node->Matches())
             {
                 std::string peptide = it.first;
+                double peptide_mass = ComputePeptideMass(peptide);
+                const std::vector<model::glycan::Glycan*>& candidate_glycan = candidates_->find(peptide)->second;
+                std::unordered_map<model::glycan::Glycan*, bool>& contained = contained_[peptide];
                 for(const auto& gt : it.second)
                 {
                     std::string glycan_id = gt.first;
                     model::glycan::Glycan* glycan = glycans_map_.find(glycan_id)->second.get();
+                    if (beam_width_ > 0 && !Admit(peptide, glycan,
+                            SearchHelper::ComputePeakScore(peaks, gt.second)))
+                        continue;
 
                     std::vector<int> peak_indexes(gt.second.begin(), gt.second.end());
                     for(const auto& g : glycan->Children())
                     {
-                        double mass = g->Mass() + util::mass::PeptideMass::Compute(peptide);
+                        // only grow the substructures of candidate glycans
+                        if (!Contained(g, contained, candidate_glycan))
+                            continue;
+
+                        double mass = g->Mass() + peptide_mass;
                         if (peak_nodes_map.find(mass) == peak_nodes_map.end())
                         {
                             std::unique_ptr<PeakNode> next = 
@@ -202,10 +340,530 @@ protected:
         return matched_nodes;
     }
 
+    // forward sweep of the lattice per peptide, glycans of equal mass form
+    // one peak node as the priority queue does, the sweep stops beyond the
+    // heaviest candidate glycan, as no heavier glycan is contained. The states
+    // are kept per node position of the lattice, reset by the touched positions.
+    void SweepDynamicProgramming(
+        const std::vector<model::spectrum::Peak>& peaks,
+        const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidates,
+        std::unordered_map<std::string, std::unordered_set<int>>& results)
+    {
+        const engine::glycan::GlycanDAG& dag = *dag_;
+        int size = dag.Size();
+        if ((int) miss_.size() != size)
+        {
+            miss_.assign(size, INT_MAX);
+            inherited_.assign(size, std::vector<int>());
+            scores_.assign(size, 0);
+            contained_at_.assign(size, kUnknown);
+        }
+
+        long nodes = 0;
+        std::vector<int> touched;
+        std::vector<int> group;
+        for(const auto& it : candidates)
+        {
+            const std::string& peptide = it.first;
+            const std::vector<model::glycan::Glycan*>& candidate_glycan = it.second;
+            double peptide_mass = ComputePeptideMass(peptide);
+            double bound = 0;
+            for(const auto& g : candidate_glycan)
+            {
+                bound = std::max(bound, g->Mass());
+            }
+
+            // no pair of the analyzer without a matched peptide
+            const std::vector<double>* site_scores = nullptr;
+            if (bounding_)
+            {
+                auto sites = peptide_scores_.find(peptide);
+                if (sites == peptide_scores_.end())
+                    continue;
+                site_scores = &sites->second;
+            }
+
+            // Y1
+            int start = size;
+            for(const auto& pos : roots_)
+            {
+                miss_[pos] = 1;
+                touched.push_back(pos);
+                start = std::min(start, pos);
+            }
+
+            int end = start;
+            for(int i = start; i < size && dag.Mass(i) <= bound + kMassEpsilon; i = end)
+            {
+                end = i + 1;
+                while (end < size && dag.Mass(end) == dag.Mass(i))
+                    end++;
+
+                // glycans of the same mass reached
+                int miss = INT_MAX;
+                group.clear();
+                for(int j = i; j < end; j++)
+                {
+                    if (miss_[j] == INT_MAX)
+                        continue;
+                    miss = std::min(miss, miss_[j]);
+                    group.push_back(j);
+                }
+                if (group.empty())
+                    continue;
+                double mass = dag.Mass(i) + peptide_mass;
+                if (bounding_ && !Promising(*site_scores, mass, peptide_mass + bound))
+                    break;
+                if (OverBudget(++nodes))
+                    break;
+
+                // max if matched a peak
+                for(const auto& j : group)
+                {
+                    Score(peaks, j);
+                }
+                MaxGroup(group);
+
+                // match peaks
+                std::vector<int> matched = fragments_ != nullptr ?
+                    ShiftMatch(peptide, mass) : searcher_->Search(mass);
+                if (matched.size() > 0)
+                {
+                    miss = 0;
+                    if (bounding_)
+                        Matched(matched);
+                    for(const auto& j : group)
+                    {
+                        inherited_[j].insert(inherited_[j].end(), matched.begin(), matched.end());
+                        Score(peaks, j);
+                        Collect(peptide, candidate_glycan, j, results);
+                    }
+                }
+
+                if (miss > kMissing)
+                    continue;
+
+                // extending to children
+                for(const auto& j : group)
+                {
+                    if (beam_width_ > 0 && !Admit(peptide, dag.GlycanOf(j), scores_[j]))
+                        continue;
+                    for(const int* c = dag.ChildBegin(j); c != dag.ChildEnd(j); c++)
+                    {
+                        if (!ContainedAt(*c, candidate_glycan, touched))
+                            continue;
+                        if (miss_[*c] == INT_MAX)
+                            touched.push_back(*c);
+                        miss_[*c] = std::min(miss_[*c], miss + 1);
+                        inherited_[*c].insert(inherited_[*c].end(), inherited_[j].begin(), inherited_[j].end());
+                    }
+                }
+            }
+
+            // the pairs of the peptide are final
+            if (bounding_)
+                RankSwept(peaks, *site_scores);
+
+            // reset states for next peptide
+            for(const auto& pos : touched)
+            {
+                miss_[pos] = INT_MAX;
+                inherited_[pos].clear();
+                contained_at_[pos] = kUnknown;
+            }
+            touched.clear();
+            if (exceeded_)
+                break;
+        }
+        expanded_ += nodes;
+        spectrum_nodes_ += nodes;
+    }
+
+    // the distinct peaks of the node and their score
+    void Score(const std::vector<model::spectrum::Peak>& peaks, int pos)
+    {
+        std::vector<int>& peak_indexes = inherited_[pos];
+        std::sort(peak_indexes.begin(), peak_indexes.end());
+        peak_indexes.erase(std::unique(peak_indexes.begin(), peak_indexes.end()), peak_indexes.end());
+        scores_[pos] = SearchHelper::ComputePeakScore(peaks, peak_indexes);
+    }
+
+    // keep the best scored glycans of each type as PeakNode::Max does,
+    // the hybrid glycans are compared within the same mannose branches
+    void MaxGroup(std::vector<int>& group) const
+    {
+        double complex_best = 0, mannose_best = 0;
+        std::vector<std::pair<std::pair<int, int>, double>> hybrid_best;
+        for(const auto& j : group)
+        {
+            double score = scores_[j];
+            switch (dag_->TypeOf(j))
+            {
+            case engine::glycan::GlycanType::Complex:
+                complex_best = std::max(complex_best, score);
+                break;
+            case engine::glycan::GlycanType::HighMannose:
+                mannose_best = std::max(mannose_best, score);
+                break;
+            case engine::glycan::GlycanType::Hybrid:
+                {
+                    std::pair<int, int> branch = MannoseBranch(j);
+                    auto best = std::find_if(hybrid_best.begin(), hybrid_best.end(),
+                        [&branch](const std::pair<std::pair<int, int>, double>& b)
+                            { return b.first == branch; });
+                    if (best == hybrid_best.end())
+                        hybrid_best.push_back(std::make_pair(branch, std::max(0.0, score)));
+                    else
+                        best->second = std::max(best->second, score);
+                }
+                break;
+            }
+        }
+
+        int kept = 0;
+        for(const auto& j : group)
+        {
+            double best = 0;
+            switch (dag_->TypeOf(j))
+            {
+            case engine::glycan::GlycanType::Complex:
+                best = complex_best;
+                break;
+            case engine::glycan::GlycanType::HighMannose:
+                best = mannose_best;
+                break;
+            case engine::glycan::GlycanType::Hybrid:
+                {
+                    std::pair<int, int> branch = MannoseBranch(j);
+                    for(const auto& b : hybrid_best)
+                    {
+                        if (b.first == branch)
+                            best = b.second;
+                    }
+                }
+                break;
+            }
+            if (scores_[j] == best)
+                group[kept++] = j;
+        }
+        group.resize(kept);
+    }
+
+    std::pair<int, int> MannoseBranch(int pos) const
+    {
+        const std::vector<int>& table = dag_->GlycanOf(pos)->TableConst();
+        return std::make_pair(table[4], table[5]);
+    }
+
+    // the candidate glycans containing the matched glycan of lattice node
+    void Collect(const std::string& peptide,
+        const std::vector<model::glycan::Glycan*>& candidate_glycan, int pos,
+        std::unordered_map<std::string, std::unordered_set<int>>& results)
+    {
+        model::glycan::Glycan* identified = dag_->GlycanOf(pos);
+        for(const auto& glycan : candidate_glycan)
+        {
+            if (Satisify(identified, glycan))
+            {
+                std::string key = SearchHelper::MakeKeyGlycoSequence(glycan->ID(), peptide);
+                std::unordered_set<int>& matched = results[key];
+                matched.insert(inherited_[pos].begin(), inherited_[pos].end());
+                if (bounding_)
+                    swept_.push_back(&matched);
+            }
+        }
+    }
+
+    // Contained of the lattice node, cached until the node is reset
+    bool ContainedAt(int pos, const std::vector<model::glycan::Glycan*>& candidate_glycan,
+        std::vector<int>& touched)
+    {
+        int8_t& contained = contained_at_[pos];
+        if (contained == kUnknown)
+        {
+            touched.push_back(pos);
+            contained = 0;
+            for(const auto& candidate : candidate_glycan)
+            {
+                if (Satisify(dag_->GlycanOf(pos), candidate))
+                {
+                    contained = 1;
+                    break;
+                }
+            }
+        }
+        return contained == 1;
+    }
+
+    // lattice nodes of the Y1 of the searching types, the table of a
+    // single core GlcNAc, as kY1, kY1_hybrid and kY1_mannose
+    void InitRoots()
+    {
+        roots_.clear();
+        if (dag_ == nullptr)
+            return;
+        for(int pos = 0; pos < dag_->Size(); pos++)
+        {
+            const std::vector<int>& table = dag_->GlycanOf(pos)->TableConst();
+            if (table.empty() || table[0] != 1 ||
+                    std::accumulate(table.begin(), table.end(), 0) != 1)
+                continue;
+            engine::glycan::GlycanType type = dag_->TypeOf(pos);
+            if ((type == engine::glycan::GlycanType::Complex && complex_) ||
+                (type == engine::glycan::GlycanType::Hybrid && hybrid_) ||
+                (type == engine::glycan::GlycanType::HighMannose && highmannose_))
+                roots_.push_back(pos);
+        }
+    }
+
+    // glycan -> whether contained by any candidate glycan of the peptide,
+    // the containment is monotone along the lattice, since the table only grows 
+    // and the terminal branch stops extending, so no descendent is missed.
+    bool Contained(model::glycan::Glycan* glycan, 
+        std::unordered_map<model::glycan::Glycan*, bool>& contained,
+        const std::vector<model::glycan::Glycan*>& candidate_glycan) const
+    {
+        auto it = contained.find(glycan);
+        if (it != contained.end())
+            return it->second;
+
+        bool result = false;
+        for(const auto& candidate : candidate_glycan)
+        {
+            if (Satisify(glycan, candidate))
+            {
+                result = true;
+                break;
+            }
+        }
+        contained[glycan] = result;
+        return result;
+    }
+
+    void InitBudget()
+    {
+        exceeded_ = false;
+        spectrum_nodes_ = 0;
+        budget_checks_ = 0;
+        if (budget_seconds_ > 0)
+            budget_start_ = std::chrono::steady_clock::now();
+    }
+
+    // nodes created by the running dp, the clock is read every few calls
+    bool OverBudget(long created)
+    {
+        if (budget_nodes_ > 0 && spectrum_nodes_ + created > budget_nodes_)
+            exceeded_ = true;
+        else if (budget_seconds_ > 0 && (++budget_checks_ & kBudgetClock) == 0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - budget_start_).count() 
+                > budget_seconds_)
+            exceeded_ = true;
+        return exceeded_;
+    }
+
+    void InitBound(const std::vector<model::spectrum::Peak>& peaks, int max_charge)
+    {
+        if (!branch_bound_)
+            return;
+
+        // a peak may be counted at each charge, still an upper bound
+        std::vector<std::pair<double, double>> bound_points;
+        bounded_ = true;
+        bound_total_ = 0;
+        peak_scores_.clear();
+        for(const auto& pk : peaks)
+        {
+            double score = log(pk.Intensity());
+            if (!(score >= 0))
+                bounded_ = false;
+            bound_total_ += score;
+            peak_scores_.push_back(score);
+            for(int charge = 1; charge <= max_charge; charge++)
+            {
+                double mass = util::mass::SpectrumMass::Compute(pk.MZ(), charge);
+                bound_points.push_back(std::make_pair(mass, score));
+            }
+        }
+        if (!(bound_total_ > 0))
+            bounded_ = false;
+        std::sort(bound_points.begin(), bound_points.end());
+
+        int size = (int) bound_points.size();
+        bound_masses_.assign(size, 0);
+        bound_prefix_.assign(size + 1, 0);
+        for(int i = 0; i < size; i++)
+        {
+            bound_masses_[i] = bound_points[i].first;
+            bound_prefix_[i + 1] = bound_prefix_[i] + bound_points[i].second;
+        }
+        peak_matched_.assign(peaks.size(), 0);
+    }
+
+    // the scores of the matched peptides as the analyzer computes them,
+    // no tier is known before the first peptide is swept
+    void InitTiers(const std::vector<model::spectrum::Peak>& peaks,
+        const std::unordered_map<std::string, std::unordered_set<int>>* peptide_results)
+    {
+        tiers_.clear();
+        peptide_scores_.clear();
+        bounding_ = branch_bound_ && bounded_ && dag_ != nullptr && peptide_results != nullptr;
+        if (!bounding_)
+            return;
+        for(const auto& it : *peptide_results)
+        {
+            std::string peptide = it.first.substr(0, it.first.find("|"));
+            peptide_scores_[peptide].push_back(SearchHelper::ComputePeakScore(peaks, it.second));
+        }
+    }
+
+    // the peaks newly matched by the swept peptide
+    void Matched(const std::vector<int>& matched)
+    {
+        for(const auto& index : matched)
+        {
+            if (peak_matched_[index])
+                continue;
+            peak_matched_[index] = 1;
+            matched_peaks_.push_back(index);
+            matched_score_ += peak_scores_[index];
+        }
+    }
+
+    // whether a pair of the peptide may reach the top k, before the sweep of
+    // the nodes from the mass. A pair scores the peaks matched so far, or those
+    // of a node from the mass up to the reach of its heaviest candidate glycan.
+    bool Promising(const std::vector<double>& site_scores, double mass, double reach) const
+    {
+        if ((int) tiers_.size() < top_k_)
+            return true;
+        int lower_index = (int) (std::lower_bound(bound_masses_.begin(), 
+            bound_masses_.end(), mass - Window(mass)) - bound_masses_.begin());
+        int upper_index = (int) (std::upper_bound(bound_masses_.begin(), 
+            bound_masses_.end(), reach + Window(reach)) - bound_masses_.begin());
+        double glycan_score = matched_score_;
+        if (upper_index > lower_index)
+            glycan_score += bound_prefix_[upper_index] - bound_prefix_[lower_index];
+        double site_score = *std::max_element(site_scores.begin(), site_scores.end());
+        double score = sqrt(site_score * glycan_score) / bound_total_;
+        return score * (1 + kBoundSlack) >= tiers_.back();
+    }
+
+    // rank the pairs of the swept peptide into the top k distinct scores,
+    // as the analyzer ranks them, then reset the peaks matched by the peptide
+    void RankSwept(const std::vector<model::spectrum::Peak>& peaks, 
+        const std::vector<double>& site_scores)
+    {
+        std::sort(swept_.begin(), swept_.end());
+        swept_.erase(std::unique(swept_.begin(), swept_.end()), swept_.end());
+        for(const auto& matched : swept_)
+        {
+            double glycan_score = SearchHelper::ComputePeakScore(peaks, *matched);
+            for(const auto& site_score : site_scores)
+            {
+                double score = sqrt(site_score * glycan_score) / bound_total_;
+                if (!(score >= 0))
+                    continue;
+                auto it = std::lower_bound(tiers_.begin(), tiers_.end(), score, std::greater<double>());
+                if (it != tiers_.end() && *it == score)
+                    continue;
+                tiers_.insert(it, score);
+                if ((int) tiers_.size() > top_k_)
+                    tiers_.pop_back();
+            }
+        }
+        swept_.clear();
+
+        for(const auto& index : matched_peaks_)
+        {
+            peak_matched_[index] = 0;
+        }
+        matched_peaks_.clear();
+        matched_score_ = 0;
+    }
+
+    // whether to extend the glycan of the score by the beam
+    bool Admit(const std::string& peptide, model::glycan::Glycan* glycan, double score)
+    {
+        if (beam_width_ > 0)
+        {
+            // queued by parents that all left the beam since
+            std::unordered_map<model::glycan::Glycan*, int>& live = live_[peptide];
+            auto it = live.find(glycan);
+            if (it != live.end() && it->second <= 0)
+                return false;
+        }
+
+        if (beam_width_ > 0)
+        {
+            // min heap of the admitted scores
+            std::vector<std::pair<double, model::glycan::Glycan*>>& beam = beam_[peptide][Depth(glycan)];
+            if ((int) beam.size() < beam_width_)
+            {
+                beam.push_back(std::make_pair(score, glycan));
+                std::push_heap(beam.begin(), beam.end(), BeamOrder);
+            }
+            else if (beam.front().first < score)
+            {
+                std::pop_heap(beam.begin(), beam.end(), BeamOrder);
+                Link(peptide, beam.back().second, -1);
+                beam.back() = std::make_pair(score, glycan);
+                std::push_heap(beam.begin(), beam.end(), BeamOrder);
+            }
+            else
+            {
+                return false;
+            }
+            Link(peptide, glycan, 1);
+        }
+        return true;
+    }
+
+    static bool BeamOrder(const std::pair<double, model::glycan::Glycan*>& a,
+        const std::pair<double, model::glycan::Glycan*>& b)
+    {
+        return a.first > b.first;
+    }
+
+    // count the glycan in the beam as a live parent of the children it extends to
+    void Link(const std::string& peptide, model::glycan::Glycan* glycan, int delta)
+    {
+        std::unordered_map<model::glycan::Glycan*, bool>& contained = contained_[peptide];
+        const std::vector<model::glycan::Glycan*>& candidate_glycan = candidates_->find(peptide)->second;
+        std::unordered_map<model::glycan::Glycan*, int>& live = live_[peptide];
+        for(const auto& g : glycan->Children())
+        {
+            if (Contained(g, contained, candidate_glycan))
+                live[g] += delta;
+        }
+    }
+
+    // number of monosaccharides
+    int Depth(model::glycan::Glycan* glycan)
+    {
+        auto it = depth_.find(glycan);
+        if (it != depth_.end())
+            return it->second;
+        int depth = 0;
+        for(const auto& m : glycan->CompositionConst())
+        {
+            depth += m.second;
+        }
+        depth_[glycan] = depth;
+        return depth;
+    }
+
+    void InitContainment(
+        const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidates)
+    {
+        candidates_ = &candidates;
+        contained_.clear();
+    }
+
+    template <class Queue>
     void InitPriorityQueue(
         const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidate, 
         std::unordered_map<double, std::unique_ptr<PeakNode>>& peak_nodes_map,
-        std::priority_queue<PeakNode*, std::vector<PeakNode*>, PeakNodeComparison>& queue)
+        Queue& queue)
     {
         for(const auto& it : candidate)
         {
@@ -222,9 +880,9 @@ protected:
                 if (complex_)
                     node->Add(it.first, kY1, std::vector<int>());
                 if (hybrid_)
-                    node->Add(it.first, kY1_mannose, std::vector<int>());
-                if (highmannose_)
                     node->Add(it.first, kY1_hybrid, std::vector<int>());
+                if (highmannose_)
+                    node->Add(it.first, kY1_mannose, std::vector<int>());
                 // add node 
                 peak_nodes_map[mass] = std::move(node);
                 // enqueue
@@ -236,13 +894,97 @@ protected:
                 if (complex_)
                     peak_nodes_map[mass]->Add(it.first, kY1, std::vector<int>());
                 if (hybrid_)
-                    peak_nodes_map[mass]->Add(it.first, kY1_mannose, std::vector<int>());
-                if (highmannose_)
                     peak_nodes_map[mass]->Add(it.first, kY1_hybrid, std::vector<int>());
+                if (highmannose_)
+                    peak_nodes_map[mass]->Add(it.first, kY1_mannose, std::vector<int>());
+            }
+        }
+    }
+
+
+    // merge-join the shifted peaks with the glycan masses for each peptide
+    void InitPeakPoints(const std::vector<model::spectrum::Peak>& peaks, int max_charge)
+    {
+        peak_points_.clear();
+        for(int i = 0; i < (int) peaks.size(); i++)
+        {
+            for(int charge = 1; charge <= max_charge; charge++)
+            {
+                double mass = util::mass::SpectrumMass::Compute(peaks[i].MZ(), charge);
+                peak_points_.push_back(std::make_pair(mass, i));
+            }
+        }
+        std::sort(peak_points_.begin(), peak_points_.end());
+    }
+
+    void InitShiftMatch(
+        const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidates)
+    {
+        const std::vector<std::pair<double, int>>& peak_points = peak_points_;
+        const std::vector<double>& fragments = *fragments_;
+        int size = (int) fragments.size();
+        hits_.clear();
+        for(const auto& it : candidates)
+        {
+            double peptide_mass = ComputePeptideMass(it.first);
+            std::unordered_map<int, std::vector<int>>& hit = hits_[it.first];
+            int start = 0;
+            for(const auto& pt : peak_points)
+            {
+                double shifted = pt.first - peptide_mass;
+                double window = Window(pt.first);
+                while (start < size && fragments[start] <= shifted - window)
+                {
+                    start++;
+                }
+                for(int j = start; j < size && fragments[j] < shifted + window; j++)
+                {
+                    if (IsMatch(fragments[j] + peptide_mass, pt.first))
+                        hit[j].push_back(pt.second);
+                }
             }
         }
     }
 
+    std::vector<int> ShiftMatch(PeakNode* node)
+    {
+        std::vector<int> matched;
+        for(const auto& it : node->MatchesRef())
+        {
+            std::vector<int> hit = ShiftMatch(it.first, node->Mass());
+            matched.insert(matched.end(), hit.begin(), hit.end());
+        }
+        return matched;
+    }
+
+    std::vector<int> ShiftMatch(const std::string& peptide, double mass)
+    {
+        const std::vector<double>& fragments = *fragments_;
+        double glycan_mass = mass - ComputePeptideMass(peptide);
+        int index = (int) (std::lower_bound(fragments.begin(), fragments.end(), 
+            glycan_mass - kMassEpsilon) - fragments.begin());
+        if (index >= (int) fragments.size() || fragments[index] > glycan_mass + kMassEpsilon)
+            return std::vector<int>();
+        const std::unordered_map<int, std::vector<int>>& hit = hits_[peptide];
+        auto pt = hit.find(index);
+        if (pt == hit.end())
+            return std::vector<int>();
+        return pt->second;
+    }
+
+    double Window(double mass) const
+    {
+        if (type_ == model::spectrum::ToleranceBy::PPM)
+            return mass * tolerance_ / 1000000.0 * 2;
+        return tolerance_;
+    }
+
+    bool IsMatch(double expect, double observe) const
+    {
+        if (type_ == model::spectrum::ToleranceBy::PPM)
+            return fabs(expect - observe) / expect * 1000000.0 < tolerance_;
+        return fabs(expect - observe) < tolerance_;
+    }
 
     void InitSearch(const std::vector<model::spectrum::Peak>& peaks, int max_charge)
     {
@@ -263,6 +1005,42 @@ protected:
 
     std::unique_ptr<algorithm::search::ISearch<int>> searcher_;
     const std::unordered_map<std::string, std::unique_ptr<model::glycan::Glycan>>& glycans_map_;
+    const engine::glycan::SubsumptionMatrix* subsumption_ = nullptr;
+    // shifted spectrum matching, peptide -> glycan mass index -> peaks
+    const std::vector<double>* fragments_ = nullptr;
+    model::spectrum::ToleranceBy type_ = model::spectrum::ToleranceBy::Dalton;
+    double tolerance_ = 0.01;
+    std::unordered_map<std::string, std::unordered_map<int, std::vector<int>>> hits_;
+    std::vector<std::pair<double, int>> peak_points_; // sorted charged masses, peak index
+    bool bucket_queue_ = false;
+    // branch and bound, beam
+    bool branch_bound_ = false;
+    int top_k_ = 1;
+    int beam_width_ = 0;
+    bool bounded_ = false; // no peak of negative log intensity in the spectrum
+    bool bounding_ = false; // of the running search
+    double bound_total_ = 0; // log intensity of all peaks, as the analyzer divides
+    std::vector<double> bound_masses_; // sorted charged masses
+    std::vector<double> bound_prefix_; // prefix sum of log intensity of the masses
+    std::vector<double> tiers_; // top k distinct scores of the swept peptides, descending
+    std::unordered_map<std::string, std::vector<double>> peptide_scores_; // peptide -> site scores
+    std::vector<std::unordered_set<int>*> swept_; // results of the swept peptide
+    std::vector<double> peak_scores_; // log intensity
+    std::vector<char> peak_matched_;
+    std::vector<int> matched_peaks_;
+    double matched_score_ = 0;
+    std::unordered_map<std::string, std::unordered_map<int, 
+        std::vector<std::pair<double, model::glycan::Glycan*>>>> beam_;
+    // peptide -> glycan -> parents in the beam that extended to it
+    std::unordered_map<std::string, std::unordered_map<model::glycan::Glycan*, int>> live_;
+    std::unordered_map<model::glycan::Glycan*, int> depth_;
+    // lattice sweep, states per node of dag
+    const engine::glycan::GlycanDAG* dag_ = nullptr;
+    std::vector<int> miss_;
+    std::vector<std::vector<int>> inherited_; // peaks of parents, distinct once swept
+    std::vector<double> scores_;
+    std::vector<int8_t> contained_at_;
+    std::vector<int> roots_;
     bool complex_;
     bool hybrid_;
     bool highmannose_;
@@ -270,7 +1048,25 @@ protected:
     const std::string kY1_hybrid = "1 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 ";
     const std::string kY1_mannose = "1 0 0 0 0 0 ";
     const int kMissing = 5;
-    std::unordered_map<std::string, double> peptide_mass_;
+    const int8_t kUnknown = -1;
+    const double kMassEpsilon = 1e-6;
+    const double kBoundSlack = 1e-9; // of the rounding, against the scores of the analyzer
+    util::mass::PeptideLadders* ladders_ = nullptr;
+    util::mass::PeptideLadders own_ladders_; // without shared ladders
+    // peptide -> glycan -> contained in candidates of the searching spectrum
+    const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>* candidates_ = nullptr;
+    std::unordered_map<std::string, std::unordered_map<model::glycan::Glycan*, bool>> contained_;
+    long expanded_ = 0;
+    // queue operations per spectrum, if recorded
+    std::vector<std::vector<double>>* traces_ = nullptr;
+    // per spectrum budget of the dp
+    long budget_nodes_ = 0;
+    double budget_seconds_ = 0;
+    long spectrum_nodes_ = 0;
+    long budget_checks_ = 0;
+    bool exceeded_ = false;
+    std::chrono::steady_clock::time_point budget_start_;
+    const long kBudgetClock = 63;
 };
 
 
@@ -34,6 +34,7 @@ public:
     void set_mass(double mass) { mass_ = mass; }
 
     PeakMatch Matches() { return matches_; }
+    const PeakMatch& MatchesRef() const { return matches_; }
     void set_matches(std::unordered_map<std::string, 
         std::unordered_map<std::string, std::unordered_set<int>>> matches)
         { matches_ = matches; }
@@ -187,6 +188,14 @@ struct PeakNodeComparison
     }
 };
 
+struct PeakNodeMass
+{
+    double operator()(PeakNode* node) const
+    {
+        return node->Mass();
+    }
+};
+
 
 } // namespace engine
 } // namespace search
@@ -82,8 +82,8 @@ BOOST_AUTO_TEST_CASE( search_engine_test )
     int special_scan = 6765;
     double ms1_tol = 10;
     model::spectrum::ToleranceBy ms1_by = model::spectrum::ToleranceBy::PPM;
-    std::unique_ptr<algorithm::search::ISearch<std::string>> searcher =
-        std::make_unique<algorithm::search::BucketSearch<std::string>>(ms1_by, ms1_tol);
+    std::unique_ptr<algorithm::search::ISearch<int>> searcher =
+        std::make_unique<algorithm::search::BucketSearch<int>>(ms1_by, ms1_tol);
 
     PrecursorMatcher precursor_runner(std::move(searcher));
     precursor_runner.Init(peptides, builder->GlycanMapsRef());
@@ -9,6 +9,7 @@
 #include "../../model/glycan/glycan.h"
 #include "../../model/spectrum/spectrum.h"
 #include "../../util/mass/ion.h"
+#include "../../util/mass/ladder.h"
 
 
 namespace engine{
@@ -52,48 +53,29 @@ public:
         return score;
     }
 
-    // for computing the peptide ions
-    static std::vector<double> ComputePTMPeptideMass(const std::string& seq, const int pos)
+    static double ComputePeakScore(const std::vector<model::spectrum::Peak>& peaks, 
+        const std::vector<int>& peak_indexes)
     {
-        std::vector<double> mass_list;
-        double mass = util::mass::PeptideMass::Compute(seq.substr(0, pos));
-        for (int i = pos; i < (int) seq.length() - 1; i++) // seldom at n
-        {
-            const char amino = seq[i];
-            mass += util::mass::PeptideMass::GetAminoAcidMW(amino);
-            mass_list.push_back(util::mass::IonMass::Compute(mass, util::mass::IonType::b));
-            mass_list.push_back(util::mass::IonMass::Compute(mass, util::mass::IonType::c));
-        }
-        mass = util::mass::PeptideMass::Compute(seq.substr(pos+1, seq.length()-pos-1));
-        for (int i = pos; i >= 1; i--)
+        double score = 0;
+        for(int index : peak_indexes)
         {
-            const char amino = seq[i];
-            mass += util::mass::PeptideMass::GetAminoAcidMW(amino);
-            mass_list.push_back(util::mass::IonMass::Compute(mass, util::mass::IonType::y));
-            mass_list.push_back(util::mass::IonMass::Compute(mass, util::mass::IonType::z));
+            score += log(peaks[index].Intensity());
         }
+        return score;
+    }
+
+    // for computing the peptide ions, of the ladder set to the peptide
+    static std::vector<double> ComputePTMPeptideMass(const util::mass::PeptideLadder& ladder, const int pos)
+    {
+        std::vector<double> mass_list;
+        ladder.GlycoFragments(pos, mass_list);
         return mass_list;
     }
 
-    static std::vector<double> ComputeNonePTMPeptideMass(const std::string& seq, const int pos)
+    static std::vector<double> ComputeNonePTMPeptideMass(const util::mass::PeptideLadder& ladder, const int pos)
     {
         std::vector<double> mass_list;
-        double mass = 18.0105;
-        for (int i = 0; i < pos; i++)
-        {
-            const char amino = seq[i];
-            mass += util::mass::PeptideMass::GetAminoAcidMW(amino);
-            mass_list.push_back(util::mass::IonMass::Compute(mass, util::mass::IonType::b));
-            mass_list.push_back(util::mass::IonMass::Compute(mass, util::mass::IonType::c));
-        }
-        mass = 18.0105;
-        for (int i = (int) seq.length()-1; i > pos; i--)
-        {
-            const char amino = seq[i];
-            mass += util::mass::PeptideMass::GetAminoAcidMW(amino);
-            mass_list.push_back(util::mass::IonMass::Compute(mass, util::mass::IonType::y));
-            mass_list.push_back(util::mass::IonMass::Compute(mass, util::mass::IonType::z));
-        }
+        ladder.Fragments(pos, mass_list);
         return mass_list;
     }
 
@@ -2,6 +2,8 @@
 #define ENGINE_SEARCH_SEQUENCE_H_
 
 #include <string>
+#include <cmath>
+#include <algorithm>
 #include <memory>
 #include <numeric>
 #include <unordered_map>
@@ -11,9 +13,11 @@
 #include "../../model/glycan/glycan.h"
 #include "../../model/spectrum/spectrum.h"
 #include "../../util/mass/ion.h"
+#include "../../util/mass/ladder.h"
 #include "../../util/mass/spectrum.h"
 #include "../protein/protein_ptm.h"
 #include "search_helper.h"
+#include "fragment_index.h"
 
 
 namespace engine{
@@ -31,6 +35,9 @@ public:
         const std::vector<model::spectrum::Peak>& peaks, int max_charge, 
         const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidate)
     {
+        if (index_ != nullptr)
+            return SearchIndex(peaks, max_charge, candidate);
+
         InitSearch(candidate);
         std::unordered_map<std::string, std::unordered_set<int>> results;
 
@@ -55,14 +62,130 @@ public:
         return results;
     }
 
+    // query the shared fragment index instead of building the points per spectrum
+    void set_fragment_index(const FragmentIndex* index, 
+        model::spectrum::ToleranceBy type, double tol)
+    {
+        index_ = index;
+        type_ = type;
+        tolerance_ = tol;
+        stamp_.assign(index->EntrySize(), 0);
+        shift_.assign(index->EntrySize(), 0);
+        epoch_ = 0;
+    }
+
+    // ladders shared with the other searchers of the thread
+    void set_ladders(util::mass::PeptideLadders* ladders) { ladders_ = ladders; }
+
+    // ms2 tolerance of the next searches, of the buckets and the index
+    void set_tolerance(double tol)
+    {
+        searcher_->set_tolerance(tol);
+        tolerance_ = tol;
+    }
+
 protected:
+    // an ion matches a peak within the tolerance, exactly. The bucket search
+    // differs next to the tolerance: it takes every ion in the bucket of the peak,
+    // slightly over the tolerance in ppm, and misses a peak past its last bucket.
+    std::unordered_map<std::string, std::unordered_set<int>> SearchIndex(
+        const std::vector<model::spectrum::Peak>& peaks, int max_charge, 
+        const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidate)
+    {
+        // restrict to the entries of precursor candidates
+        epoch_++;
+        std::vector<int> allowed;
+        for(const auto& it : candidate)
+        {
+            double glycan_mean_mass = SearchHelper::ComputeGlycanMass(it.second);
+            std::pair<int, int> entries = index_->Entries(it.first);
+            for(int e = entries.first; e < entries.second; e++)
+            {
+                stamp_[e] = epoch_;
+                shift_[e] = glycan_mean_mass;
+                allowed.push_back(e);
+            }
+        }
+
+        std::vector<std::pair<double, int>> peak_points;
+        for(int i = 0; i < (int) peaks.size(); i++)
+        {
+            for(int charge = 1; charge < max_charge; charge++)
+            {
+                double target = util::mass::SpectrumMass::Compute(peaks[i].MZ(), charge);
+                peak_points.push_back(std::make_pair(target, i));
+            }
+        }
+        std::sort(peak_points.begin(), peak_points.end());
+
+        std::unordered_map<int, std::unordered_set<int>> hits;
+        // ions without glycan, filtered by entries
+        const double* masses = index_->Masses();
+        const int* entries = index_->Entries();
+        int size = index_->FragmentSize();
+        for(const auto& pt : peak_points)
+        {
+            double window = Window(pt.first);
+            int j = (int) (std::lower_bound(masses, masses + size, pt.first - window) - masses);
+            for(; j < size && masses[j] <= pt.first + window; j++)
+            {
+                if (stamp_[entries[j]] == epoch_ && IsMatch(masses[j], pt.first))
+                    hits[entries[j]].insert(pt.second);
+            }
+        }
+        // ions with glycan, merge-join the shifted ladder
+        for(int e : allowed)
+        {
+            int start = 0;
+            for(const double* m = index_->LadderBegin(e); m != index_->LadderEnd(e); m++)
+            {
+                double mass = *m + shift_[e];
+                while (start < (int) peak_points.size() && 
+                    peak_points[start].first < mass - Window(peak_points[start].first))
+                    start++;
+                for(int k = start; k < (int) peak_points.size() && 
+                    peak_points[k].first <= mass + Window(peak_points[k].first); k++)
+                {
+                    if (IsMatch(mass, peak_points[k].first))
+                        hits[e].insert(peak_points[k].second);
+                }
+            }
+        }
+
+        std::unordered_map<std::string, std::unordered_set<int>> results;
+        for(auto& it : hits)
+        {
+            std::string table_key = SearchHelper::MakeKeySequence(
+                index_->Peptide(it.first), index_->Site(it.first));
+            results[table_key].insert(it.second.begin(), it.second.end());
+        }
+        return results;
+    }
+
+    double Window(double mass) const
+    {
+        if (type_ == model::spectrum::ToleranceBy::PPM)
+            return mass * tolerance_ / 1000000.0;
+        return tolerance_;
+    }
+
+    // relative to the observed mass for ppm, as the bucket search
+    bool IsMatch(double expect, double observe) const
+    {
+        if (type_ == model::spectrum::ToleranceBy::PPM)
+            return fabs(expect - observe) / observe * 1000000.0 < tolerance_;
+        return fabs(expect - observe) < tolerance_;
+    }
+
     void InitSearch(
         const std::unordered_map<std::string, std::vector<model::glycan::Glycan*>>& candidate)
     {
         std::vector<std::shared_ptr<algorithm::search::Point<std::string>>> peptides_points;
+        util::mass::PeptideLadders& ladders = ladders_ != nullptr ? *ladders_ : own_ladders_;
         for(const auto& it : candidate)
         {
-            std::string peptide = it.first;
+            const std::string& peptide = it.first;
+            const util::mass::PeptideLadder* ladder = nullptr;
             // get glycan mass
             double glycan_mean_mass = SearchHelper::ComputeGlycanMass(it.second);
 
@@ -73,11 +196,10 @@ protected:
                 //init table
                 if (mass_table_.find(table_key) == mass_table_.end())
                 {
-                    
-                    std::vector<double> mass_list = SearchHelper::ComputeNonePTMPeptideMass(peptide, pos);
-                    mass_table_[table_key] = std::vector<double>(mass_list);
-                    mass_list = SearchHelper::ComputePTMPeptideMass(peptide, pos);
-                    ptm_mass_table_[table_key] = std::vector<double>(mass_list);
+                    if (ladder == nullptr)
+                        ladder = &ladders.Set(peptide);
+                    ladder->Fragments(pos, mass_table_[table_key]);
+                    ladder->GlycoFragments(pos, ptm_mass_table_[table_key]);
                 }
                 // retreive table
                 for(double mass : mass_table_[table_key])
@@ -103,6 +225,15 @@ protected:
     // mass table to store the computed ptm / non-ptm results
     std::unordered_map<std::string, std::vector<double>> ptm_mass_table_;
     std::unordered_map<std::string, std::vector<double>> mass_table_;
+    util::mass::PeptideLadders* ladders_ = nullptr;
+    util::mass::PeptideLadders own_ladders_; // without shared ladders
+    // shared fragment index, entry -> stamp of the current spectrum
+    const FragmentIndex* index_ = nullptr;
+    model::spectrum::ToleranceBy type_ = model::spectrum::ToleranceBy::Dalton;
+    double tolerance_ = 0.01;
+    std::vector<int> stamp_;
+    std::vector<double> shift_;
+    int epoch_ = 0;
 };
 
 
@@ -16,6 +16,7 @@
 #include "precursor_match.h"
 
 #include <chrono> 
+#include <cfloat>
 
 namespace engine{
 namespace search {
@@ -55,6 +56,110 @@ namespace search {
 
 
 
+// the index takes the ions within the tolerance of a peak, the buckets
+// may take or miss a few just next to the tolerance
+BOOST_AUTO_TEST_CASE( index_search_test ) 
+{
+    engine::glycan::GlycanBuilder builder(3, 3, 1, 0, 0);
+    builder.Build();
+    std::vector<model::glycan::Glycan*> glycans;
+    for(const auto& it : builder.GlycanMapsRef())
+    {
+        if (glycans.size() < 3)
+            glycans.push_back(it.second.get());
+    }
+    std::vector<std::string> peptides {"AVNKSTR", "LPNGTEK", "NASNKTAVR"};
+    std::unordered_map<std::string, std::vector<model::glycan::Glycan*>> candidates;
+    for(const auto& seq : peptides)
+    {
+        candidates[seq] = glycans;
+    }
+    FragmentIndex index;
+    util::parallel::WorkStealingPool pool(2);
+    index.Build(peptides, pool);
+
+    std::vector<std::pair<model::spectrum::ToleranceBy, double>> tolerances {
+        {model::spectrum::ToleranceBy::Dalton, 0.01}, {model::spectrum::ToleranceBy::PPM, 10}};
+    for(const auto& tol : tolerances)
+    {
+        bool ppm = tol.first == model::spectrum::ToleranceBy::PPM;
+        // ions by key of peptide and site
+        std::unordered_map<std::string, std::vector<double>> ions;
+        util::mass::PeptideLadder ladder;
+        for(const auto& seq : peptides)
+        {
+            double glycan_mass = SearchHelper::ComputeGlycanMass(glycans);
+            ladder.Set(seq);
+            for(int pos : engine::protein::ProteinPTM::FindNGlycanSite(seq))
+            {
+                std::vector<double>& masses = ions[SearchHelper::MakeKeySequence(seq, pos)];
+                masses = SearchHelper::ComputeNonePTMPeptideMass(ladder, pos);
+                for(double mass : SearchHelper::ComputePTMPeptideMass(ladder, pos))
+                {
+                    masses.push_back(mass + glycan_mass);
+                }
+            }
+        }
+
+        // peaks on, inside and just outside the tolerance of the ions
+        std::vector<model::spectrum::Peak> peaks;
+        for(const auto& it : ions)
+        {
+            for(double mass : it.second)
+            {
+                double window = ppm ? mass * tol.second / 1000000.0 : tol.second;
+                for(double offset : {0.0, 0.5, -0.5, 0.99, -0.99, 1.01, -1.01, 1.5})
+                {
+                    peaks.push_back(model::spectrum::Peak(
+                        util::mass::SpectrumMass::ComputeMZ(mass + offset * window, 1), 1.0));
+                }
+            }
+        }
+
+        std::unordered_map<std::string, std::unordered_set<int>> expect;
+        for(const auto& it : ions)
+        {
+            for(int i = 0; i < (int) peaks.size(); i++)
+            {
+                double observe = util::mass::SpectrumMass::Compute(peaks[i].MZ(), 1);
+                for(double mass : it.second)
+                {
+                    double delta = fabs(mass - observe);
+                    if ((ppm ? delta / observe * 1000000.0 : delta) < tol.second)
+                        expect[it.first].insert(i);
+                }
+            }
+        }
+
+        SequenceSearch bucket(std::make_unique<algorithm::search::BucketSearch<std::string>>(tol.first, tol.second));
+        SequenceSearch indexed(std::make_unique<algorithm::search::BucketSearch<std::string>>(tol.first, tol.second));
+        indexed.set_fragment_index(&index, tol.first, tol.second);
+        auto bucket_results = bucket.Search(peaks, 2, candidates);
+        auto index_results = indexed.Search(peaks, 2, candidates);
+        BOOST_CHECK(index_results == expect);
+
+        // the paths differ only next to the tolerance
+        for(const auto& it : ions)
+        {
+            std::unordered_set<int>& by_bucket = bucket_results[it.first];
+            std::unordered_set<int>& by_index = index_results[it.first];
+            for(int i = 0; i < (int) peaks.size(); i++)
+            {
+                if (by_bucket.count(i) == by_index.count(i))
+                    continue;
+                double observe = util::mass::SpectrumMass::Compute(peaks[i].MZ(), 1);
+                double nearest = DBL_MAX;
+                for(double mass : it.second)
+                {
+                    double delta = fabs(mass - observe);
+                    nearest = std::min(nearest, ppm ? delta / observe * 1000000.0 : delta);
+                }
+                BOOST_CHECK(nearest > tol.second * 0.9 && nearest < tol.second * 1.1);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE( search_engine_test ) 
 {
     // read spectrum
@@ -100,8 +205,8 @@ BOOST_AUTO_TEST_CASE( search_engine_test )
     int special_scan = 13233;
     double ms1_tol = 10;
     model::spectrum::ToleranceBy ms1_by = model::spectrum::ToleranceBy::PPM;
-    std::unique_ptr<algorithm::search::ISearch<std::string>> searcher =
-        std::make_unique<algorithm::search::BucketSearch<std::string>>(ms1_by, ms1_tol);
+    std::unique_ptr<algorithm::search::ISearch<int>> searcher =
+        std::make_unique<algorithm::search::BucketSearch<int>>(ms1_by, ms1_tol);
 
     PrecursorMatcher precursor_runner(std::move(searcher));
     precursor_runner.Init(peptides, builder->GlycanMapsRef());
@@ -0,0 +1,91 @@
+#ifndef ENGINE_SPECTRUM_OXONIUM_FILTER_H_
+#define ENGINE_SPECTRUM_OXONIUM_FILTER_H_
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "../../model/spectrum/spectrum.h"
+
+namespace engine {
+namespace spectrum {
+
+// triage of glycopeptide spectrum by the diagnostic oxonium ions,
+// a spectrum is accepted when at least min_count of the ions are
+// observed above the relative intensity of the base peak.
+class OxoniumFilter
+{
+public:
+    OxoniumFilter(model::spectrum::ToleranceBy type, double tol,
+        double relative_intensity=0.05, int min_count=2):
+        type_(type), tolerance_(tol), relative_intensity_(relative_intensity),
+        min_count_(min_count), ions_({kHexNAc, kHexNAcFragment,
+            kHexHexNAc, kNeuAcWaterLoss, kNeuAc}){}
+
+    double RelativeIntensity() const { return relative_intensity_; }
+    int MinCount() const { return min_count_; }
+    const std::vector<double>& Ions() const { return ions_; }
+    void set_relative_intensity(double relative_intensity)
+        { relative_intensity_ = relative_intensity; }
+    void set_min_count(int min_count) { min_count_ = min_count; }
+    void set_tolerance(double tol) { tolerance_ = tol; }
+    void set_ions(const std::vector<double>& ions) { ions_ = ions; }
+
+    bool Accept(const std::vector<model::spectrum::Peak>& peaks) const
+    {
+        double base = 0;
+        for(const auto& pk : peaks)
+        {
+            base = std::max(base, pk.Intensity());
+        }
+        if (base <= 0)
+            return false;
+
+        // mark each oxonium ion once
+        double threshold = base * relative_intensity_;
+        std::vector<bool> found(ions_.size(), false);
+        int count = 0;
+        for(const auto& pk : peaks)
+        {
+            if (pk.Intensity() < threshold)
+                continue;
+            for(int i = 0; i < (int) ions_.size(); i++)
+            {
+                if (!found[i] && IsMatch(ions_[i], pk.MZ()))
+                {
+                    found[i] = true;
+                    count++;
+                }
+            }
+            if (count >= min_count_)
+                return true;
+        }
+        return count >= min_count_;
+    }
+
+    bool IsMatch(double expect, double observe) const
+    {
+        if (type_ == model::spectrum::ToleranceBy::PPM)
+        {
+           return std::fabs(expect - observe) / expect * 1000000.0 < tolerance_;
+        }
+        return std::fabs(expect - observe) < tolerance_;
+    }
+
+    static constexpr double kHexNAc = 204.087;
+    static constexpr double kHexNAcFragment = 138.055;
+    static constexpr double kHexHexNAc = 366.140;
+    static constexpr double kNeuAcWaterLoss = 274.092;
+    static constexpr double kNeuAc = 292.103;
+
+protected:
+    model::spectrum::ToleranceBy type_;
+    double tolerance_;
+    double relative_intensity_;
+    int min_count_;
+    std::vector<double> ions_;
+};
+
+} // namespace spectrum
+} // namespace engine
+
+#endif
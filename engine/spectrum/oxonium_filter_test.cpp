@@ -0,0 +1,38 @@
+#define BOOST_TEST_MODULE OxoniumFilterTest
+#include <boost/test/unit_test.hpp>
+#include "../../model/spectrum/spectrum.h"
+#include "oxonium_filter.h"
+
+namespace engine {
+namespace spectrum {
+
+BOOST_AUTO_TEST_CASE( oxonium_filter_test ) 
+{
+    std::vector<model::spectrum::Peak> peaks;
+    peaks.push_back(model::spectrum::Peak(138.0553, 400));
+    peaks.push_back(model::spectrum::Peak(204.0868, 900));
+    peaks.push_back(model::spectrum::Peak(366.1401, 2));
+    peaks.push_back(model::spectrum::Peak(512.2371, 1000));
+
+    OxoniumFilter filter(model::spectrum::ToleranceBy::Dalton, 0.01, 0.05, 2);
+    BOOST_CHECK(filter.Accept(peaks));
+
+    // 366.14 is below the relative intensity
+    filter.set_min_count(3);
+    BOOST_CHECK(!filter.Accept(peaks));
+    filter.set_relative_intensity(0.001);
+    BOOST_CHECK(filter.Accept(peaks));
+
+    // ppm tolerance
+    OxoniumFilter ppm_filter(model::spectrum::ToleranceBy::PPM, 10, 0.05, 1);
+    BOOST_CHECK(ppm_filter.Accept(peaks));
+    peaks[0].set_mz(138.06);
+    peaks[1].set_mz(204.09);
+    BOOST_CHECK(!ppm_filter.Accept(peaks));
+
+    BOOST_CHECK(!filter.Accept(std::vector<model::spectrum::Peak>()));
+}
+
+
+} // namespace spectrum
+} // namespace engine
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <vector>
+#include <array>
+#include <cstdint>
 #include <map> 
 #include <set>
 #include <memory>
@@ -27,6 +29,9 @@ public:
     // Mass
     double Mass() { return mass_; }
     void set_mass(double mass) { mass_ = mass; }
+    // position in the built library
+    int Index() const { return index_; }
+    void set_index(int index) { index_ = index; }
     // derived
     std::vector<Glycan*> Children() { return children_; }
     void Add(Glycan* glycan) { children_.push_back(glycan); }
@@ -92,6 +97,42 @@ public:
             table_[index] = num;
     }
 
+    static const int kLanes = 32;
+    // table packed as 8-bit lanes, the last lane is the table size,
+    // terminal lanes are set at branches stopped by the terminal sugers.
+    const std::array<uint8_t, kLanes>& Packed() const { return packed_; }
+    const std::array<uint8_t, kLanes>& Terminal() const { return terminal_; }
+    void Pack()
+    {
+        packed_.fill(0);
+        terminal_.fill(0);
+        int size = std::min((int) table_.size(), kLanes - 1);
+        for(int i = 0; i < size; i++)
+        {
+            packed_[i] = (uint8_t) std::min(std::max(table_[i], 0), 255);
+        }
+        packed_[kLanes - 1] = (uint8_t) table_.size();
+        terminal_[kLanes - 1] = 0xFF;
+
+        // terminal Fuc, NeuAc at the branch
+        if (size == 24)
+        {
+            for(int i = 0; i < 4; i++)
+            {
+                if (table_[12 + i] > 0 || table_[16 + i] > 0)
+                    terminal_[4 + i] = 0xFF;
+            }
+        }
+        else if (size == 16)
+        {
+            for(int i = 0; i < 2; i++)
+            {
+                if (table_[10 + i] > 0 || table_[12 + i] > 0)
+                    terminal_[6 + i] = 0xFF;
+            }
+        }
+    }
+
     std::map<Monosaccharide, int>&  Composition()
         { return composite_; }
     void set_composition(const std::map<Monosaccharide, int>& composite)
@@ -108,6 +149,9 @@ public:
 
 protected:
     double mass_ = -1;
+    int index_ = -1;
+    std::array<uint8_t, kLanes> packed_ {};
+    std::array<uint8_t, kLanes> terminal_ {};
     // std::set<double> fragments_;
     std::string name_;
     std::vector<int> table_;
@@ -11,17 +11,11 @@ public:
     Peak(double mz, double intensity):
         mz_(mz), intensity_(intensity){}
 
-    Peak(const Peak& other)
-    {
-        mz_ = other.mz_;
-        intensity_ = other.intensity_;
-    }
-    Peak& operator=(const Peak& other)
-    {
-        mz_ = other.mz_;
-        intensity_ = other.intensity_;
-        return *this;
-    }
+    // trivially copyable, vectors of peaks are moved and copied as memory
+    Peak(const Peak& other) = default;
+    Peak(Peak&& other) = default;
+    Peak& operator=(const Peak& other) = default;
+    Peak& operator=(Peak&& other) = default;
 
     double MZ() const { return mz_; }
     void set_mz(double mz) { mz_ = mz; }
@@ -2,6 +2,7 @@
 #define MODEL_SPECTRUM_SPECTRUM_H_
 
 #include <vector>
+#include <utility>
 #include "peak.h"
 
 namespace model {
@@ -13,35 +14,25 @@ class Spectrum
 {
 public:
     Spectrum() = default;
-    Spectrum(const Spectrum& other){
-        peaks_ = std::move(other.peaks_);
-        scan_num_ = other.scan_num_;
-        retention_ = other.retention_;
-        precursor_mz_ = other.precursor_mz_;
-        precursor_charge_ = other.precursor_charge_;
-    }
-
-    Spectrum& operator=(const Spectrum& other){
-        peaks_ = std::move(other.peaks_);
-        scan_num_ = other.scan_num_;
-        retention_ = other.retention_;
-        precursor_mz_ = other.precursor_mz_;
-        precursor_charge_ = other.precursor_charge_;
-        return *this;
-    }
-
-    int Scan() { return scan_num_; }
+    Spectrum(const Spectrum& other) = default;
+    Spectrum(Spectrum&& other) = default;
+    Spectrum& operator=(const Spectrum& other) = default;
+    Spectrum& operator=(Spectrum&& other) = default;
+
+    int Scan() const { return scan_num_; }
     void set_scan(int scan) { scan_num_ = scan; }
-    int Retention() { return retention_; }
+    int Retention() const { return retention_; }
     void set_retention(double retention) { retention_ = retention; }
 
     std::vector<Peak>& Peaks() { return peaks_; }
     const std::vector<Peak>& Peaks() const { return peaks_; }
     void set_peaks(std::vector<Peak>& peaks) 
         { peaks_ = std::move(peaks); }
+    void set_peaks(std::vector<Peak>&& peaks) 
+        { peaks_ = std::move(peaks); }
 
-    double PrecursorMZ() { return precursor_mz_; }
-    double PrecursorCharge() { return precursor_charge_; }
+    double PrecursorMZ() const { return precursor_mz_; }
+    double PrecursorCharge() const { return precursor_charge_; }
 
     void set_parent_mz(double mz) { precursor_mz_ = mz;}
     void set_parent_charge(int charge) { precursor_charge_ = charge; }
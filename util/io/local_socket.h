@@ -0,0 +1,192 @@
+#ifndef UTIL_IO_LOCAL_SOCKET_H_
+#define UTIL_IO_LOCAL_SOCKET_H_
+
+#include <string>
+#include <cstring>
+#include <utility>
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+namespace util {
+namespace io {
+
+// unix domain stream socket exchanging lines of text,
+// not available on windows, where every call fails. A write to a closed
+// peer fails with EPIPE instead of raising SIGPIPE.
+class LocalSocket
+{
+public:
+    LocalSocket() = default;
+    LocalSocket(const LocalSocket&) = delete;
+    LocalSocket& operator=(const LocalSocket&) = delete;
+    LocalSocket(LocalSocket&& other): fd_(other.fd_), buffer_(std::move(other.buffer_))
+        { other.fd_ = -1; }
+    ~LocalSocket() { Close(); }
+
+    // a stale socket at the path is replaced, any other file is left and fails
+    bool Listen(const std::string& path)
+    {
+#ifndef _WIN32
+        sockaddr_un address;
+        if (!Address(path, address))
+            return false;
+        struct stat status;
+        if (lstat(path.c_str(), &status) == 0)
+        {
+            if (!S_ISSOCK(status.st_mode) || unlink(path.c_str()) != 0)
+                return false;
+        }
+        else if (errno != ENOENT)
+            return false;
+        if (!Open())
+            return false;
+        if (bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(fd_, 16) != 0)
+        {
+            Close();
+            return false;
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // the next client of a listening socket
+    bool Accept(LocalSocket& client)
+    {
+#ifndef _WIN32
+        client.Close();
+        client.fd_ = accept(fd_, nullptr, nullptr);
+        if (client.fd_ < 0)
+            return false;
+        client.NoSignal();
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool Connect(const std::string& path)
+    {
+#ifndef _WIN32
+        sockaddr_un address;
+        if (!Address(path, address) || !Open())
+            return false;
+        if (connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            Close();
+            return false;
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // a line without the newline, false at the end of stream
+    bool ReadLine(std::string& line)
+    {
+#ifndef _WIN32
+        while (true)
+        {
+            size_t end = buffer_.find('\n');
+            if (end != std::string::npos)
+            {
+                line = buffer_.substr(0, end);
+                buffer_.erase(0, end + 1);
+                return true;
+            }
+            char chunk[4096];
+            ssize_t size = read(fd_, chunk, sizeof(chunk));
+            if (size < 0 && errno == EINTR)
+                continue;
+            if (size <= 0)
+                return false;
+            buffer_.append(chunk, (size_t) size);
+        }
+#else
+        return false;
+#endif
+    }
+
+    bool Write(const std::string& text)
+    {
+#ifndef _WIN32
+        size_t sent = 0;
+        while (sent < text.size())
+        {
+            ssize_t size = send(fd_, text.data() + sent, text.size() - sent, kSendFlags);
+            if (size < 0 && errno == EINTR)
+                continue;
+            if (size <= 0)
+                return false;
+            sent += (size_t) size;
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void Close()
+    {
+#ifndef _WIN32
+        if (fd_ >= 0)
+            close(fd_);
+#endif
+        fd_ = -1;
+        buffer_.clear();
+    }
+
+protected:
+#ifndef _WIN32
+    bool Open()
+    {
+        Close();
+        fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd_ < 0)
+            return false;
+        NoSignal();
+        return true;
+    }
+
+    // where send has no MSG_NOSIGNAL, e.g., macos, the socket is marked instead
+    void NoSignal()
+    {
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+        int on = 1;
+        setsockopt(fd_, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    }
+
+#ifdef MSG_NOSIGNAL
+    static const int kSendFlags = MSG_NOSIGNAL;
+#else
+    static const int kSendFlags = 0;
+#endif
+
+    static bool Address(const std::string& path, sockaddr_un& address)
+    {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            return false;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        return true;
+    }
+#endif
+
+    int fd_ = -1;
+    std::string buffer_;
+};
+
+} // namespace io
+} // namespace util
+
+#endif
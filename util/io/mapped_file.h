@@ -0,0 +1,85 @@
+#ifndef UTIL_IO_MAPPED_FILE_H_
+#define UTIL_IO_MAPPED_FILE_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace util {
+namespace io {
+
+// read-only view of a whole file, memory mapped so that processes share
+// the pages through the page cache, or read into memory on windows.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { Close(); }
+
+    bool Open(const std::string& path)
+    {
+        Close();
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        data_ = static_cast<const char*>(data);
+        size_ = (size_t) st.st_size;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return false;
+        buffer_.resize((size_t) file.tellg());
+        file.seekg(0);
+        file.read(buffer_.data(), buffer_.size());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#endif
+        return true;
+    }
+
+    void Close()
+    {
+#ifndef _WIN32
+        if (data_ != nullptr)
+            munmap(const_cast<char*>(data_), size_);
+#else
+        buffer_.clear();
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+protected:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    std::vector<char> buffer_;
+#endif
+};
+
+} // namespace io
+} // namespace util
+
+#endif
@@ -5,6 +5,7 @@
 #include <map> 
 #include <fstream>
 #include <regex>
+#include <utility>
 #include "spectrum_reader.h"
 
 namespace util {
@@ -116,6 +117,15 @@ public:
         }
         return std::vector<Peak>();
     }
+    std::vector<Peak> ReleasePeaks(int scan_num) override
+    {         
+        auto it = data_set_.find(scan_num); 
+        if (it != data_set_.end())
+        {
+            return std::move(it->second.peaks);
+        }
+        return std::vector<Peak>();
+    }
 
     double RTFromScanNum(int scan_num) override
     {
@@ -23,6 +23,8 @@ public:
     virtual int GetLastScan(){ return 0; }
 
     virtual std::vector<Peak> Peaks(int scan_num){ return std::vector<Peak>(); }
+    // peaks moved out of the parser, Peaks of the scan is empty after
+    virtual std::vector<Peak> ReleasePeaks(int scan_num){ return Peaks(scan_num); }
     virtual std::string GetScanInfo(int scan_num){ return ""; }
     virtual double RTFromScanNum(int scan_num){ return 0; }
     virtual bool Exist(int scan_num){ return false; }
@@ -57,20 +59,7 @@ public:
     
     Spectrum GetSpectrum(int scan_num)
     {
-        Spectrum spectrum;
-        if (parser_->Exist(scan_num))
-        {
-            std::vector<Peak> peaks = parser_->Peaks(scan_num);
-            double mz = parser_->ParentMZ(scan_num);
-            int charge = parser_->ParentCharge(scan_num);
-            double retention = parser_->RTFromScanNum(scan_num);
-            spectrum.set_peaks(peaks);
-            spectrum.set_scan(scan_num);
-            spectrum.set_retention(retention);
-            spectrum.set_parent_mz(mz);
-            spectrum.set_parent_charge(charge);
-        }
-        return spectrum;
+        return MakeSpectrum(scan_num, false);
     }
   
     std::vector<Spectrum> GetSpectrum(int start, int last)
@@ -91,7 +80,39 @@ public:
         return GetSpectrum(start, last);
     }
 
+    // all spectra, with the peaks moved out of the parser instead of copied
+    std::vector<Spectrum> ReleaseSpectrum()
+    {
+        std::vector<Spectrum> result;
+        int last = GetLastScan();
+        for (int scan_num = GetFirstScan(); scan_num <= last; scan_num++)
+        {
+            if (parser_->Exist(scan_num))
+                result.push_back(MakeSpectrum(scan_num, true));
+        }
+        return result;
+    }
+
 protected:
+    Spectrum MakeSpectrum(int scan_num, bool release)
+    {
+        Spectrum spectrum;
+        if (parser_->Exist(scan_num))
+        {
+            std::vector<Peak> peaks = release ? 
+                parser_->ReleasePeaks(scan_num) : parser_->Peaks(scan_num);
+            double mz = parser_->ParentMZ(scan_num);
+            int charge = parser_->ParentCharge(scan_num);
+            double retention = parser_->RTFromScanNum(scan_num);
+            spectrum.set_peaks(peaks);
+            spectrum.set_scan(scan_num);
+            spectrum.set_retention(retention);
+            spectrum.set_parent_mz(mz);
+            spectrum.set_parent_charge(charge);
+        }
+        return spectrum;
+    }
+
     std::string path_;
     std::unique_ptr<SpectrumParser> parser_;
     
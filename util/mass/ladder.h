@@ -0,0 +1,128 @@
+#ifndef UTIL_MASS_LADDER_H
+#define UTIL_MASS_LADDER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "peptide.h"
+#include "ion.h"
+
+namespace util {
+namespace mass {
+
+// b, c, y and z ions of a peptide around a glycosite, from the residue masses
+// summed once per peptide. The sums keep the order of the residues, so the ions
+// are the same to the bit as summed per site, with the fixed modification of C
+// in the part before the site carrying the glycan only, as before. The part
+// after the site carrying the glycan is the total less the prefix, the same but
+// for the rounding of the last bits.
+class PeptideLadder
+{
+public:
+    // reuses the arrays of the peptide before
+    void Set(const std::string& seq)
+    {
+        Set(seq.data(), (int) seq.length());
+    }
+
+    void Set(const char* seq, int length)
+    {
+        const ResidueTable& table = PeptideMass::Table();
+        seq_.assign(seq, length);
+        PeptideMass::Prefix(seq_, prefix_);
+        forward_.resize(length + 1);
+        backward_.resize(length + 1);
+        forward_[0] = PeptideMass::kWater;
+        backward_[length] = PeptideMass::kWater;
+        for (int i = 0; i < length; i++)
+        {
+            forward_[i + 1] = forward_[i] + table.mass[(unsigned char) seq[i]];
+        }
+        for (int i = length - 1; i >= 0; i--)
+        {
+            backward_[i] = backward_[i + 1] + table.mass[(unsigned char) seq[i]];
+        }
+    }
+
+    // peptide mass as PeptideMass::Compute
+    double Mass() const { return prefix_.back(); }
+    const std::string& Sequence() const { return seq_; }
+
+    // the ions without the glycan at pos, b and c of the residues before, y and z after
+    void Fragments(int pos, std::vector<double>& out) const
+    {
+        for (int i = 0; i < pos; i++)
+        {
+            out.push_back(IonMass::Compute(forward_[i + 1], IonType::b));
+            out.push_back(IonMass::Compute(forward_[i + 1], IonType::c));
+        }
+        for (int i = (int) seq_.length() - 1; i > pos; i--)
+        {
+            out.push_back(IonMass::Compute(backward_[i], IonType::y));
+            out.push_back(IonMass::Compute(backward_[i], IonType::z));
+        }
+    }
+
+    // the ions carrying the glycan at pos, without the glycan mass
+    void GlycoFragments(int pos, std::vector<double>& out) const
+    {
+        const ResidueTable& table = PeptideMass::Table();
+        int length = (int) seq_.length();
+        double mass = prefix_[pos];
+        for (int i = pos; i < length - 1; i++) // seldom at n
+        {
+            mass += table.mass[(unsigned char) seq_[i]];
+            out.push_back(IonMass::Compute(mass, IonType::b));
+            out.push_back(IonMass::Compute(mass, IonType::c));
+        }
+        mass = prefix_.back() - prefix_[pos + 1] + PeptideMass::kWater;
+        for (int i = pos; i >= 1; i--)
+        {
+            mass += table.mass[(unsigned char) seq_[i]];
+            out.push_back(IonMass::Compute(mass, IonType::y));
+            out.push_back(IonMass::Compute(mass, IonType::z));
+        }
+    }
+
+protected:
+    std::string seq_;
+    // with the fixed modification, and of the residues only from either end
+    std::vector<double> prefix_;
+    std::vector<double> forward_;
+    std::vector<double> backward_;
+};
+
+// the ladder of a peptide, shared by the searchers of a thread: the sequence
+// search takes the ions and the glycan search the mass of the one ladder set
+// for the peptide. The masses are kept by peptide.
+class PeptideLadders
+{
+public:
+    // the ladder of the peptide, until the next Set
+    const PeptideLadder& Set(const std::string& seq)
+    {
+        if (seq != ladder_.Sequence() || masses_.empty())
+        {
+            ladder_.Set(seq);
+            masses_.emplace(seq, ladder_.Mass());
+        }
+        return ladder_;
+    }
+
+    double Mass(const std::string& seq)
+    {
+        auto it = masses_.find(seq);
+        if (it != masses_.end())
+            return it->second;
+        return Set(seq).Mass();
+    }
+
+protected:
+    PeptideLadder ladder_;
+    std::unordered_map<std::string, double> masses_;
+};
+
+} // namespace mass
+} // namespace util
+
+#endif
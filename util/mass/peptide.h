@@ -2,82 +2,101 @@
 #define UTIL_MASS_PEPTIDE_H
 
 #include <string>
-#include <cctype>
+#include <vector>
+#include <cstddef>
 
 namespace util {
 namespace mass {
 
+// residue masses by char, the lowercase as the uppercase, with the fixed
+// modification added before the residue, as iodoacetamide of C
+struct ResidueTable
+{
+    double mass[256];
+    double fixed[256];
+};
+
+constexpr ResidueTable MakeResidueTable()
+{
+    ResidueTable table {};
+    for (int c = 0; c < 256; c++)
+    {
+        table.mass[c] = 118.9;   //Average molecular weight of an amino acid
+        table.fixed[c] = 0;
+    }
+    const char residues[] = "ACDEFGHIKLMNPQRSTVWY$@#";
+    const double masses[] = {
+        71.0371, 103.00919, 115.02694, 129.04259, 147.06841,
+        57.02146, 137.05891, 113.08406, 
+        128.09496, //128.09497
+        113.08406, 131.04049, 114.04293, 97.05276, 128.05858, 
+        156.10111, //156.10112
+        87.03203, 101.04768, 
+        99.06841, //99.06842
+        186.07931, //186.07932
+        163.06333,
+        131.04049 + 15.994915, // oxidation of M
+        114.04293 + 0.984016, // Deamidated N
+        114.04293 + 0.984016};
+    for (int i = 0; residues[i] != '\0'; i++)
+    {
+        char c = residues[i];
+        table.mass[(unsigned char) c] = masses[i];
+        if (c >= 'A' && c <= 'Z')
+            table.mass[(unsigned char) (c - 'A' + 'a')] = masses[i];
+    }
+    //Iodoacetamide
+    table.fixed[(unsigned char) 'C'] = 57.02146;
+    table.fixed[(unsigned char) 'c'] = 57.02146;
+    return table;
+}
+
 class PeptideMass
 {
 public:
+    static constexpr double kWater = 18.0105;
+
     static double Compute(const std::string& seq)
     {
-        double mass = 18.0105;  //water
-        for (char s : seq)
+        return Compute(seq.data(), seq.length());
+    }
+
+    static double Compute(const char* seq, size_t length)
+    {
+        const ResidueTable& table = Table();
+        double mass = kWater;
+        for (size_t i = 0; i < length; i++)
         {
-            if (std::toupper(s) == 'C')
-            {
-                //Iodoacetamide
-                mass += 57.02146;
-            }
-            mass += GetAminoAcidMW(s);
+            unsigned char s = (unsigned char) seq[i];
+            mass += table.fixed[s];
+            mass += table.mass[s];
         }
         return mass;
     }
 
-    static double GetAminoAcidMW(const char amino)
+    // prefix[i], the mass of the first i residues as Compute, from the water
+    static void Prefix(const std::string& seq, std::vector<double>& prefix)
     {
-        switch (std::toupper(amino))
+        const ResidueTable& table = Table();
+        prefix.resize(seq.length() + 1);
+        prefix[0] = kWater;
+        for (size_t i = 0; i < seq.length(); i++)
         {
-            case 'A':
-                return 71.0371;
-            case 'C':
-                return 103.00919;
-            case 'D':
-                return 115.02694;
-            case 'E':
-                return 129.04259;
-            case 'F':
-                return 147.06841;
-            case 'G':
-                return 57.02146;
-            case 'H':
-                return 137.05891;
-            case 'I':
-                return 113.08406;
-            case 'K':
-                return 128.09496; //128.09497
-            case 'L':
-                return 113.08406;
-            case 'M':
-                return 131.04049;
-            case 'N':
-                return 114.04293;
-            case 'P':
-                return 97.05276;
-            case 'Q':
-                return 128.05858;
-            case 'R':
-                return 156.10111; //156.10112
-            case 'S':
-                return 87.03203;
-            case 'T':
-                return 101.04768;
-            case 'V':
-                return 99.06841; //99.06842
-            case 'W':
-                return 186.07931; //186.07932
-            case 'Y':
-                return 163.06333;
-            case '$':
-                return 131.04049 + 15.994915; // oxidation of M
-            case '@':
-            case '#':
-                return 114.04293 + 0.984016; // Deamidated N
-            default:
-                return 118.9;   //Average molecular weight of an amino acid
+            unsigned char s = (unsigned char) seq[i];
+            prefix[i + 1] = prefix[i] + table.fixed[s] + table.mass[s];
         }
     }
+
+    static double GetAminoAcidMW(const char amino)
+    {
+        return Table().mass[(unsigned char) amino];
+    }
+
+    static const ResidueTable& Table()
+    {
+        static constexpr ResidueTable table = MakeResidueTable();
+        return table;
+    }
 };
 
 } // namespace mass
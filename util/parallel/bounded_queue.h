@@ -0,0 +1,193 @@
+#ifndef UTIL_PARALLEL_BOUNDED_QUEUE_H_
+#define UTIL_PARALLEL_BOUNDED_QUEUE_H_
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <cstddef>
+
+namespace util {
+namespace parallel {
+
+// bounded lock-free queue of many producers and consumers, a ring of cells
+// each stamped with the turn it waits for. A producer or consumer claims a
+// position by compare and swap, then publishes the cell by its stamp.
+// Push and Pop spin a few turns on a full or empty queue, then sleep on a
+// condition variable, which is only locked when a thread sleeps. A pusher
+// sleeping on its mutex may wake the poppers, never the other way round.
+template <class T>
+class BoundedQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit BoundedQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for(size_t i = 0; i < size; i++)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // false if full, the item is moved in otherwise
+    bool TryPush(T& item)
+    {
+        size_t pos = enqueue_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            long diff = (long) sequence - (long) pos;
+            if (diff == 0)
+            {
+                if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = enqueue_.load(std::memory_order_relaxed);
+        }
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        Wake(pop_waiting_, pop_mutex_, not_empty_);
+        return true;
+    }
+
+    // false if empty
+    bool TryPop(T& item)
+    {
+        size_t pos = dequeue_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            long diff = (long) sequence - (long) (pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = dequeue_.load(std::memory_order_relaxed);
+        }
+        item = std::move(cell->data);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        Wake(push_waiting_, push_mutex_, not_full_);
+        return true;
+    }
+
+    // waits while full
+    void Push(T item)
+    {
+        for(int spin = 0; !TryPush(item); spin++)
+        {
+            if (spin < kSpins)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(push_mutex_);
+            push_waiting_.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            not_full_.wait(lock, [this, &item] { return TryPush(item); });
+            push_waiting_.fetch_sub(1);
+            break;
+        }
+    }
+
+    // waits while empty, false once closed and drained
+    bool Pop(T& item)
+    {
+        for(int spin = 0; ; spin++)
+        {
+            if (TryPop(item))
+                return true;
+            if (closed_.load(std::memory_order_acquire))
+                return TryPop(item);
+            if (spin < kSpins)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(pop_mutex_);
+            pop_waiting_.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            not_empty_.wait(lock, [this] { return !Empty() || closed_.load(std::memory_order_acquire); });
+            pop_waiting_.fetch_sub(1);
+        }
+    }
+
+    // no more pushes, called after the last producer pushed
+    void Close()
+    {
+        closed_.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(pop_mutex_);
+        not_empty_.notify_all();
+    }
+
+protected:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    // the cell of the next pop is not published yet
+    bool Empty() const
+    {
+        size_t pos = dequeue_.load(std::memory_order_relaxed);
+        size_t sequence = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+        return (long) sequence - (long) (pos + 1) < 0;
+    }
+
+    // the fence orders the cell just published before the count of sleepers,
+    // as a sleeper counts itself before it checks the cells again
+    void Wake(std::atomic<int>& waiting, std::mutex& mutex, std::condition_variable& condition)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) == 0)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        condition.notify_all();
+    }
+
+    // turns of yield before sleeping
+    static const int kSpins = 16;
+
+    // the positions of producers and consumers on their own cache lines
+    char padding0_[64];
+    std::atomic<size_t> enqueue_ {0};
+    char padding1_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_ {0};
+    char padding2_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<bool> closed_ {false};
+    size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    // a pusher sleeping on a full queue, a popper on an empty one
+    std::mutex push_mutex_;
+    std::mutex pop_mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::atomic<int> push_waiting_ {0};
+    std::atomic<int> pop_waiting_ {0};
+};
+
+} // namespace parallel
+} // namespace util
+
+#endif
@@ -0,0 +1,135 @@
+#define BOOST_TEST_MODULE BoundedQueueTest
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+
+#include "bounded_queue.h"
+
+namespace util {
+namespace parallel {
+
+BOOST_AUTO_TEST_CASE( bounded_queue_test ) 
+{
+    BoundedQueue<int> queue(3);
+    int item = 0;
+    BOOST_CHECK(!queue.TryPop(item));
+    for(int i = 0; i < 4; i++)
+    {
+        item = i;
+        BOOST_CHECK(queue.TryPush(item));
+    }
+    item = 4;
+    BOOST_CHECK(!queue.TryPush(item));
+
+    // first in, first out
+    for(int i = 0; i < 4; i++)
+    {
+        BOOST_CHECK(queue.TryPop(item));
+        BOOST_CHECK(item == i);
+    }
+    queue.Close();
+    BOOST_CHECK(!queue.Pop(item));
+}
+
+BOOST_AUTO_TEST_CASE( bounded_queue_threads_test ) 
+{
+    // every item pushed by the producers is popped once by the consumers
+    const int kProducers = 3, kConsumers = 3, kItems = 20000;
+    BoundedQueue<std::unique_ptr<int>> queue(16);
+    std::vector<int> popped(kProducers * kItems, 0);
+    std::atomic<int> producing {kProducers};
+    std::vector<std::thread> threads;
+    for(int p = 0; p < kProducers; p++)
+    {
+        threads.push_back(std::thread([&queue, &producing, p]
+        {
+            for(int i = 0; i < kItems; i++)
+            {
+                queue.Push(std::make_unique<int>(p * kItems + i));
+            }
+            if (producing.fetch_sub(1) == 1)
+                queue.Close();
+        }));
+    }
+    std::vector<std::vector<int>> seen(kConsumers);
+    for(int c = 0; c < kConsumers; c++)
+    {
+        threads.push_back(std::thread([&queue, &seen, c]
+        {
+            std::unique_ptr<int> item;
+            while (queue.Pop(item))
+            {
+                seen[c].push_back(*item);
+            }
+        }));
+    }
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+    for(const auto& items : seen)
+    {
+        // the items of a producer keep their order for a consumer
+        for(int i = 1; i < (int) items.size(); i++)
+        {
+            if (items[i] / kItems == items[i - 1] / kItems)
+                BOOST_CHECK(items[i] > items[i - 1]);
+        }
+        for(int i : items)
+        {
+            popped[i]++;
+        }
+    }
+    BOOST_CHECK(std::count(popped.begin(), popped.end(), 1) == (int) popped.size());
+}
+
+BOOST_AUTO_TEST_CASE( bounded_queue_sleep_test ) 
+{
+    // consumers of an empty queue and a producer of a full queue sleep,
+    // instead of spending the cpu, until an item or the close wakes them
+    BoundedQueue<int> empty(4), full(2);
+    int item = 0;
+    while (full.TryPush(item))
+        item++;
+    std::atomic<int> popped {0};
+    std::vector<std::thread> threads;
+    for(int c = 0; c < 3; c++)
+    {
+        threads.push_back(std::thread([&empty, &popped]
+        {
+            int value = 0;
+            while (empty.Pop(value))
+            {
+                popped++;
+            }
+        }));
+    }
+    std::thread pusher([&full] { full.Push(100); });
+
+    std::clock_t start = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    double cpu_seconds = (double) (std::clock() - start) / CLOCKS_PER_SEC;
+    BOOST_CHECK(cpu_seconds < 0.1);
+
+    empty.Push(1);
+    BOOST_CHECK(full.TryPop(item));
+    pusher.join();
+    for(int i = 0; i < 2; i++)
+    {
+        BOOST_CHECK(full.TryPop(item));
+    }
+    BOOST_CHECK(item == 100);
+    empty.Close();
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+    BOOST_CHECK(popped == 1);
+}
+
+} // namespace parallel
+} // namespace util
@@ -0,0 +1,165 @@
+#ifndef UTIL_PARALLEL_WORK_STEALING_POOL_H_
+#define UTIL_PARALLEL_WORK_STEALING_POOL_H_
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+namespace util {
+namespace parallel {
+
+// persistent workers running a range of indexes in chunks. Each worker owns
+// a deque of chunks, takes from its back, and steals from the front of the
+// others once its own deque is empty, so a lock is only shared when stealing.
+class WorkStealingPool
+{
+public:
+    // worker id, then the chunk [first, last)
+    typedef std::function<void(int, int, int)> Task;
+
+    WorkStealingPool(int n_thread)
+    {
+        n_thread = std::max(1, n_thread);
+        for(int i = 0; i < n_thread; i++)
+        {
+            deques_.push_back(std::make_unique<ChunkDeque>());
+        }
+        for(int i = 0; i < n_thread; i++)
+        {
+            workers_.push_back(std::thread(&WorkStealingPool::Worker, this, i));
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for(auto& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    int Size() const { return (int) workers_.size(); }
+
+    // runs task over [0, size) and returns when all chunks are done,
+    // chunk of 0 picks about 16 chunks per worker
+    void Run(int size, const Task& task, int chunk=0)
+    {
+        if (size <= 0)
+            return;
+        int n_thread = Size();
+        if (chunk <= 0)
+            chunk = std::max(1, size / (n_thread * 16));
+
+        // contiguous ranges, so that a worker without stealing keeps the order
+        for(int w = 0; w < n_thread; w++)
+        {
+            int first = (int) ((long) size * w / n_thread);
+            int last = (int) ((long) size * (w + 1) / n_thread);
+            ChunkDeque& deque = *deques_[w];
+            std::lock_guard<std::mutex> lock(deque.mutex);
+            for(int i = first; i < last; i += chunk)
+            {
+                deque.chunks.push_front(std::make_pair(i, std::min(last, i + chunk)));
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_ = &task;
+        running_ = n_thread;
+        generation_++;
+        start_.notify_all();
+        done_.wait(lock, [this] { return running_ == 0; });
+        task_ = nullptr;
+    }
+
+protected:
+    struct ChunkDeque
+    {
+        std::mutex mutex;
+        std::deque<std::pair<int, int>> chunks;
+    };
+
+    bool Pop(int w, std::pair<int, int>& chunk)
+    {
+        ChunkDeque& deque = *deques_[w];
+        std::lock_guard<std::mutex> lock(deque.mutex);
+        if (deque.chunks.empty())
+            return false;
+        chunk = deque.chunks.back();
+        deque.chunks.pop_back();
+        return true;
+    }
+
+    bool Steal(int w, std::pair<int, int>& chunk)
+    {
+        int n_thread = Size();
+        for(int i = 1; i < n_thread; i++)
+        {
+            ChunkDeque& deque = *deques_[(w + i) % n_thread];
+            std::lock_guard<std::mutex> lock(deque.mutex);
+            if (!deque.chunks.empty())
+            {
+                chunk = deque.chunks.front();
+                deque.chunks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Worker(int w)
+    {
+        long seen = 0;
+        while (true)
+        {
+            const Task* task = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+                if (stop_)
+                    return;
+                seen = generation_;
+                task = task_;
+            }
+
+            // chunks are never added during a run, empty everywhere is the end
+            std::pair<int, int> chunk;
+            while (Pop(w, chunk) || Steal(w, chunk))
+            {
+                (*task)(w, chunk.first, chunk.second);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--running_ == 0)
+                done_.notify_all();
+        }
+    }
+
+    std::vector<std::unique_ptr<ChunkDeque>> deques_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const Task* task_ = nullptr;
+    long generation_ = 0;
+    int running_ = 0;
+    bool stop_ = false;
+};
+
+} // namespace parallel
+} // namespace util
+
+#endif
@@ -0,0 +1,58 @@
+#define BOOST_TEST_MODULE WorkStealingPoolTest
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+#include "work_stealing_pool.h"
+
+namespace util {
+namespace parallel {
+
+BOOST_AUTO_TEST_CASE( work_stealing_pool_test ) 
+{
+    WorkStealingPool pool(4);
+    BOOST_CHECK(pool.Size() == 4);
+
+    // the same threads serve both runs, every index is done once
+    for(int run = 0; run < 2; run++)
+    {
+        std::vector<int> done(1000, 0);
+        pool.Run((int) done.size(), [&done](int w, int first, int last)
+        {
+            for(int i = first; i < last; i++)
+            {
+                done[i]++;
+            }
+        }, 7);
+        BOOST_CHECK(std::count(done.begin(), done.end(), 1) == (int) done.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( work_stealing_pool_steal_test ) 
+{
+    // the first quarter is slow, the others have to steal from its worker
+    WorkStealingPool pool(4);
+    std::vector<int> worker(64, -1);
+    pool.Run((int) worker.size(), [&worker](int w, int first, int last)
+    {
+        for(int i = first; i < last; i++)
+        {
+            worker[i] = w;
+            if (i < 16)
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }, 1);
+    int stolen = 0;
+    for(int i = 0; i < 16; i++)
+    {
+        BOOST_CHECK(worker[i] >= 0);
+        if (worker[i] != worker[0])
+            stolen++;
+    }
+    BOOST_CHECK(stolen > 0);
+}
+
+} // namespace parallel
+} // namespace util